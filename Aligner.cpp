@@ -5,6 +5,9 @@
 #include <functional>
 #include <algorithm>
 #include <thread>
+#include <chrono>
+#include <limits>
+#include <memory>
 #include "Aligner.h"
 #include "CommonUtils.h"
 #include "vg.pb.h"
@@ -13,6 +16,11 @@
 #include "BigraphToDigraph.h"
 #include "ThreadReadAssertion.h"
 #include "GraphAlignerWrapper.h"
+#include "BoundedQueue.h"
+#include "ReadScheduler.h"
+#include "SeedIndex.h"
+#include "SeedChainer.h"
+#include "ComponentThreadPool.h"
 
 bool is_file_exist(std::string fileName)
 {
@@ -99,51 +107,136 @@ void writeTrace(const std::vector<AlignmentResult::TraceItem>& trace, const std:
 	}
 }
 
-void runComponentMappings(const AlignmentGraph& alignmentGraph, std::vector<const FastQ*>& fastQs, std::mutex& fastqMutex, std::vector<vg::Alignment>& alignments, int threadnum, const std::map<const FastQ*, std::vector<std::tuple<int, size_t, bool>>>* graphAlignerSeedHits, AlignerParams params)
+const char* MetricsHeader = "read\tlength\tstatus\tscore\tseeds\tchains\tskippedseeds\tslices\tbitvectorslices\talternateslices\tparallelslices\tprojectednodes\tcells\tramps\tbacktraceoverrides\toverridebytes\tcheckpoints\tcheckpointratio\ttime_ms\tforward_us\tbacktrace_us\tdecode_us\toutput_us\n";
+//indexed by AlignmentResult::CheckpointPolicy
+const char* CheckpointPolicyNames[] = { "all", "sqrt", "recursive", "none" };
+
+std::string metricsLine(const FastQ& read, const std::string& status, const AlignmentResult& alignment)
+{
+	std::stringstream line;
+	line << read.seq_id << "\t" << read.sequence.size() << "\t" << status << "\t";
+	if (status == "aligned") line << alignment.alignment.score(); else line << "-";
+	line << "\t" << alignment.stats.seedsTried;
+	line << "\t" << alignment.stats.seedChains;
+	line << "\t" << alignment.stats.seedsSkipped;
+	line << "\t" << alignment.stats.slices;
+	line << "\t" << alignment.stats.bitvectorSlices;
+	line << "\t" << alignment.stats.alternateSlices;
+	line << "\t" << alignment.stats.parallelSlices;
+	line << "\t" << alignment.stats.projectedNodes;
+	line << "\t" << alignment.cellsProcessed;
+	line << "\t" << alignment.stats.rampEvents;
+	line << "\t" << alignment.stats.backtraceOverrides;
+	line << "\t" << alignment.stats.backtraceOverridePeakBytes;
+	line << "\t" << CheckpointPolicyNames[alignment.stats.checkpointPolicy];
+	//raw bytes per compressed byte
+	line << "\t";
+	if (alignment.stats.checkpointCompressedBytes > 0) line << (double)alignment.stats.checkpointRawBytes / (double)alignment.stats.checkpointCompressedBytes; else line << "-";
+	line << "\t" << alignment.elapsedMilliseconds;
+	line << "\t" << alignment.stats.forwardMicroseconds;
+	line << "\t" << alignment.stats.backtraceMicroseconds;
+	line << "\t" << alignment.stats.checkpointDecodeMicroseconds;
+	line << "\t" << alignment.stats.outputMicroseconds;
+	line << "\n";
+	return line.str();
+}
+
+const char* ScoreOnlyHeader = "read\tlength\tscore\tstart\tend\tstartnode\tstartoffset\tstartreverse\tendnode\tendoffset\tendreverse\n";
+
+std::string scoreOnlyLine(const FastQ& read, const AlignmentResult& alignment)
+{
+	std::stringstream line;
+	line << read.seq_id << "\t" << read.sequence.size() << "\t" << alignment.alignment.score() << "\t" << alignment.alignmentStart << "\t" << alignment.alignmentEnd;
+	line << "\t" << alignment.startPosition.nodeID << "\t" << alignment.startPosition.offset << "\t" << (alignment.startPosition.reverse ? 1 : 0);
+	line << "\t" << alignment.endPosition.nodeID << "\t" << alignment.endPosition.offset << "\t" << (alignment.endPosition.reverse ? 1 : 0);
+	line << "\n";
+	return line.str();
+}
+
+//score-only alignments go to scoreQueue instead of writeQueue if it's not null
+void runComponentMappings(const AlignmentGraph& alignmentGraph, ReadScheduler& readScheduler, BoundedQueue<vg::Alignment>& writeQueue, BoundedQueue<std::string>* scoreQueue, BoundedQueue<std::string>* metricsQueue, int threadnum, const std::map<std::string, std::vector<std::tuple<int, size_t, bool>>>* graphAlignerSeedHits, const SeedIndex* seedIndex, ComponentThreadPool* componentPool, AlignerParams params)
 {
 	assertSetRead("Before any read");
 	BufferedWriter cerroutput {std::cerr};
 	BufferedWriter coutoutput {std::cout};
+	size_t numAlignments = 0;
+	AlignerWorkspace workspace { alignmentGraph, componentPool };
+	size_t checkpointMemoryBudget = (size_t)params.checkpointMemoryMB * 1024 * 1024;
+	SeedChainer seedChainer { alignmentGraph };
+	std::vector<FastQ> batch;
+	size_t batchIndex = 0;
 	while (true)
 	{
-		const FastQ* fastq;
-		size_t fastqSize;
+		if (batchIndex == batch.size())
 		{
-			std::lock_guard<std::mutex> lock {fastqMutex};
-			if (fastQs.size() == 0) break;
-			fastq = fastQs.back();
-			fastQs.pop_back();
-			fastqSize = fastQs.size();
+			if (!readScheduler.pop(threadnum, batch)) break;
+			batchIndex = 0;
 		}
+		const FastQ* fastq = &batch[batchIndex];
+		batchIndex++;
+		size_t fastqSize = readScheduler.size();
 		assertSetRead(fastq->seq_id);
-		coutoutput << "thread " << threadnum << " " << fastqSize << " left\n";
+		coutoutput << "thread " << threadnum << " " << fastqSize << " queued\n";
 		coutoutput << "read " << fastq->seq_id << " size " << fastq->sequence.size() << "bp" << BufferedWriter::Flush;
 
 		AlignmentResult alignment;
+		alignment.cellsProcessed = 0;
+		alignment.elapsedMilliseconds = 0;
+		auto writeMetrics = [metricsQueue, fastq, &alignment](const std::string& status)
+		{
+			if (metricsQueue != nullptr) metricsQueue->push(metricsLine(*fastq, status, alignment));
+		};
 
 		try
 		{
-			if (graphAlignerSeedHits == nullptr)
+			if (graphAlignerSeedHits == nullptr && seedIndex == nullptr)
 			{
-				alignment = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, params.dynamicRowStart);
+				alignment = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, params.dynamicRowStart, checkpointMemoryBudget, workspace);
 			}
 			else
 			{
-				if (graphAlignerSeedHits->find(fastq) == graphAlignerSeedHits->end())
+				std::vector<std::tuple<int, size_t, bool>> seeds;
+				if (graphAlignerSeedHits != nullptr)
+				{
+					auto found = graphAlignerSeedHits->find(fastq->seq_id);
+					if (found != graphAlignerSeedHits->end()) seeds = found->second;
+				}
+				else
+				{
+					seeds = seedIndex->GetSeeds(alignmentGraph, fastq->sequence, params.maxSeedsPerRead);
+				}
+				if (seeds.size() == 0)
 				{
 					coutoutput << "read " << fastq->seq_id << " has no seed hits" << BufferedWriter::Flush;
 					cerroutput << "read " << fastq->seq_id << " has no seed hits" << BufferedWriter::Flush;
 					coutoutput << "read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
 					cerroutput << "read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+					writeMetrics("noseeds");
 					continue;
 				}
-				alignment = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, params.dynamicRowStart, graphAlignerSeedHits->at(fastq));
+				size_t numChains = 0;
+				size_t droppedSeeds = 0;
+				seeds = seedChainer.BestChainSeeds(seeds, params.maxSeedChains, numChains, droppedSeeds);
+				if (droppedSeeds > 0)
+				{
+					cerroutput << "read " << fastq->seq_id << " extends " << seeds.size() << " of " << numChains << " seed chains, " << droppedSeeds << " other seeds are not used" << BufferedWriter::Flush;
+				}
+				if (scoreQueue != nullptr)
+				{
+					alignment = AlignOneWayScoreOnly(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, params.seedStopFraction, seeds, workspace);
+				}
+				else
+				{
+					alignment = AlignOneWay(alignmentGraph, fastq->seq_id, fastq->sequence, params.initialBandwidth, params.rampBandwidth, params.dynamicRowStart, checkpointMemoryBudget, params.seedStopFraction, seeds, workspace);
+				}
+				alignment.stats.seedChains = numChains;
 			}
 		}
 		catch (const ThreadReadAssertion::AssertionFailure& a)
 		{
 			coutoutput << "read " << fastq->seq_id << "alignment failed (assertion!)" << BufferedWriter::Flush;
 			cerroutput << "read " << fastq->seq_id << "alignment failed (assertion!)" << BufferedWriter::Flush;
+			writeMetrics("assertion");
 			continue;
 		}
 
@@ -154,12 +247,14 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, std::vector<cons
 		{
 			coutoutput << "read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
 			cerroutput << "read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+			writeMetrics("failed");
 			continue;
 		}
 		if (alignment.alignment.score() == std::numeric_limits<decltype(alignment.alignment.score())>::max())
 		{
 			coutoutput << "read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
 			cerroutput << "read " << fastq->seq_id << " alignment failed" << BufferedWriter::Flush;
+			writeMetrics("failed");
 			continue;
 		}
 
@@ -170,38 +265,78 @@ void runComponentMappings(const AlignmentGraph& alignmentGraph, std::vector<cons
 		}
 		coutoutput << "read " << fastq->seq_id << " alignment positions: " << alignment.alignmentStart << "-" << alignment.alignmentEnd << " (read " << fastq->sequence.size() << "bp)" << BufferedWriter::Flush;
 
+		writeMetrics("aligned");
+		numAlignments++;
+		coutoutput << "thread " << threadnum << " successfully aligned read " << fastq->seq_id << " with " << alignment.cellsProcessed << " cells" << BufferedWriter::Flush;
+		if (scoreQueue != nullptr)
+		{
+			scoreQueue->push(scoreOnlyLine(*fastq, alignment));
+			continue;
+		}
+
 		replaceDigraphNodeIdsWithOriginalNodeIds(alignment.alignment);
+		if (params.outputPerReadFiles)
+		{
+			std::vector<vg::Alignment> alignmentvec;
+			alignmentvec.emplace_back(alignment.alignment);
+			std::string filename;
+			filename = "alignment_";
+			filename += std::to_string(threadnum);
+			filename += "_";
+			filename += fastq->seq_id;
+			filename += ".gam";
+			std::replace(filename.begin(), filename.end(), '/', '_');
+			std::replace(filename.begin(), filename.end(), ':', '_');
+			coutoutput << "write alignment to " << filename << BufferedWriter::Flush;
+			std::ofstream alignmentOut { filename, std::ios::out | std::ios::binary };
+			stream::write_buffered(alignmentOut, alignmentvec, 0);
+			coutoutput << "alignment write finished" << BufferedWriter::Flush;
+			std::string tracefilename;
+			tracefilename = "trace_";
+			tracefilename += std::to_string(threadnum);
+			tracefilename += "_";
+			tracefilename += fastq->seq_id;
+			tracefilename += ".trace";
+			std::replace(tracefilename.begin(), tracefilename.end(), '/', '_');
+			std::replace(tracefilename.begin(), tracefilename.end(), ':', '_');
+			coutoutput << "write trace to " << tracefilename << BufferedWriter::Flush;
+			writeTrace(alignment.trace, tracefilename);
+			coutoutput << "trace write finished" << BufferedWriter::Flush;
+		}
+		writeQueue.push(std::move(alignment.alignment));
+	}
+	assertSetRead("After all reads");
+	coutoutput << "thread " << threadnum << " finished with " << numAlignments << " alignments" << BufferedWriter::Flush;
+}
 
-		alignments.push_back(alignment.alignment);
-		coutoutput << "thread " << threadnum << " successfully aligned read " << fastq->seq_id << " with " << alignment.cellsProcessed << " cells" << BufferedWriter::Flush;
-		std::vector<vg::Alignment> alignmentvec;
-		alignmentvec.emplace_back(alignments.back());
-		std::string filename;
-		filename = "alignment_";
-		filename += std::to_string(threadnum);
-		filename += "_";
-		filename += fastq->seq_id;
-		filename += ".gam";
-		std::replace(filename.begin(), filename.end(), '/', '_');
-		std::replace(filename.begin(), filename.end(), ':', '_');
-		coutoutput << "write alignment to " << filename << BufferedWriter::Flush;
-		std::ofstream alignmentOut { filename, std::ios::out | std::ios::binary };
-		stream::write_buffered(alignmentOut, alignmentvec, 0);
-		coutoutput << "alignment write finished" << BufferedWriter::Flush;
-		std::string tracefilename;
-		tracefilename = "trace_";
-		tracefilename += std::to_string(threadnum);
-		tracefilename += "_";
-		tracefilename += fastq->seq_id;
-		tracefilename += ".trace";
-		std::replace(tracefilename.begin(), tracefilename.end(), '/', '_');
-		std::replace(tracefilename.begin(), tracefilename.end(), ':', '_');
-		coutoutput << "write trace to " << tracefilename << BufferedWriter::Flush;
-		writeTrace(alignment.trace, tracefilename);
-		coutoutput << "trace write finished" << BufferedWriter::Flush;
+const char* FullBandScoreHeader = "read\tlength\tscore\tnode\toffset\treverse\n";
+
+void runFullBandScoring(const AlignmentGraph& alignmentGraph, ReadScheduler& readScheduler, BoundedQueue<std::string>& scoreQueue, int threadnum)
+{
+	assertSetRead("Before any read");
+	BufferedWriter coutoutput {std::cout};
+	FullBandWorkspace workspace { alignmentGraph, FullBandLanes() };
+	size_t numScored = 0;
+	std::vector<FastQ> batch;
+	while (readScheduler.pop(threadnum, batch))
+	{
+		std::vector<std::string> sequences;
+		for (const auto& read : batch)
+		{
+			sequences.push_back(read.sequence);
+		}
+		assertSetRead(batch[0].seq_id);
+		auto scores = ScoreFullBand(alignmentGraph, sequences, workspace);
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			std::stringstream line;
+			line << batch[i].seq_id << "\t" << batch[i].sequence.size() << "\t" << scores[i].score << "\t" << scores[i].endNodeId << "\t" << scores[i].endOffset << "\t" << (scores[i].endReverse ? 1 : 0) << "\n";
+			scoreQueue.push(line.str());
+		}
+		numScored += batch.size();
 	}
 	assertSetRead("After all reads");
-	coutoutput << "thread " << threadnum << " finished with " << alignments.size() << " alignments" << BufferedWriter::Flush;
+	coutoutput << "thread " << threadnum << " finished with " << numScored << " scored reads" << BufferedWriter::Flush;
 }
 
 AlignmentGraph getGraph(std::string graphFile)
@@ -221,6 +356,10 @@ AlignmentGraph getGraph(std::string graphFile)
 	{
 		return DirectedGraph::StreamGFAGraphFromFile(graphFile);
 	}
+	else if (graphFile.substr(graphFile.size() - 4) == ".gai")
+	{
+		return AlignmentGraph::LoadIndex(graphFile);
+	}
 	else
 	{
 		std::cerr << "Unknown graph type (" << graphFile << ")" << std::endl;
@@ -232,86 +371,196 @@ void alignReads(AlignerParams params)
 {
 	assertSetRead("Preprocessing");
 
-	std::vector<FastQ> fastqs;
-	if (is_file_exist(params.fastqFile)){
-		fastqs = loadFastqFromFile(params.fastqFile);
-		std::cout << fastqs.size() << " reads" << std::endl;
-	}
-	else{
+	if (params.fastqFile != "-" && !is_file_exist(params.fastqFile))
+	{
 		std::cerr << "No fastq file exists" << std::endl;
 		std::exit(0);
 	}
 
-	const std::map<const FastQ*, std::vector<std::tuple<int, size_t, bool>>>* seedHitsToThreads = nullptr;
-	std::map<const FastQ*, std::vector<std::tuple<int, size_t, bool>>> seedHits;
+	const std::map<std::string, std::vector<std::tuple<int, size_t, bool>>>* seedHitsToThreads = nullptr;
+	std::map<std::string, std::vector<std::tuple<int, size_t, bool>>> seedHits;
 
 	if (params.seedFile != "")
 	{
-		std::map<std::string, std::vector<vg::Alignment>> seeds;
-		{
-			if (is_file_exist(params.seedFile)){
-				std::ifstream seedfile { params.seedFile, std::ios::in | std::ios::binary };
-				std::function<void(vg::Alignment&)> alignmentLambda = [&seeds](vg::Alignment& a) {
-					seeds[a.name()].push_back(a);
-				};
-				stream::for_each(seedfile, alignmentLambda);
-			}
-			else {
-				std::cerr << "No seeds file exists" << std::endl;
-				std::exit(0);
-			}
+		if (is_file_exist(params.seedFile)){
+			std::ifstream seedfile { params.seedFile, std::ios::in | std::ios::binary };
+			std::function<void(vg::Alignment&)> alignmentLambda = [&seedHits](vg::Alignment& seedhit) {
+				seedHits[seedhit.name()].emplace_back(seedhit.path().mapping(0).position().node_id(), seedhit.query_position(), seedhit.path().mapping(0).position().is_reverse());
+			};
+			stream::for_each(seedfile, alignmentLambda);
 		}
-		for (size_t i = 0; i < fastqs.size(); i++)
+		else {
+			std::cerr << "No seeds file exists" << std::endl;
+			std::exit(0);
+		}
+		seedHitsToThreads = &seedHits;
+	}
+
+	//the reads are parsed by a separate thread while the graph is loading and the alignments are running
+	//the scheduler holds a bounded window of reads so memory use doesn't depend on the number of reads
+	//long reads in the window go first so a long read doesn't end up running alone at the end
+	const size_t ScheduleWindowReads = 100;
+	const size_t ScheduleWindowBases = 2000000;
+	const size_t ShortReadLength = 10000;
+	const size_t ShortReadBatchSize = 10;
+	size_t batchLength = ShortReadLength;
+	size_t batchSize = ShortReadBatchSize;
+	if (params.fullBandScoreFile != "")
+	{
+		//full band scoring runs one batch in lockstep, so every read is batched
+		batchLength = std::numeric_limits<size_t>::max();
+		batchSize = FullBandLanes();
+	}
+	ReadScheduler readScheduler { (size_t)params.numThreads, params.numThreads * ScheduleWindowReads, params.numThreads * ScheduleWindowBases, batchLength, batchSize };
+	size_t numReads = 0;
+	std::thread readerThread { [&readScheduler, &numReads, params]() {
+		streamFastqFromFile(params.fastqFile, [&readScheduler, &numReads](FastQ& read) {
+			numReads++;
+			readScheduler.push(std::move(read));
+		}, params.numThreads);
+		readScheduler.close();
+	} };
+
+	//alignments are written by one thread as they finish, in chunks of AlignmentWriteChunkSize
+	//they are kept in memory only if the augmented graph needs them
+	const size_t AlignmentWriteChunkSize = 100;
+	BoundedQueue<vg::Alignment> writeQueue { (size_t)params.numThreads * 4 };
+	std::vector<vg::Alignment> alignments;
+	size_t numAlignments = 0;
+	std::thread writerThread { [&writeQueue, &alignments, &numAlignments, AlignmentWriteChunkSize, params]() {
+		std::ofstream alignmentOut;
+		if (params.alignmentFile != "") alignmentOut.open(params.alignmentFile, std::ios::out | std::ios::binary);
+		std::vector<vg::Alignment> buffer;
+		vg::Alignment alignment;
+		while (writeQueue.pop(alignment))
 		{
-			for (size_t j = 0; j < seeds[fastqs[i].seq_id].size(); j++)
+			numAlignments++;
+			if (params.auggraphFile != "") alignments.push_back(alignment);
+			if (params.alignmentFile == "") continue;
+			buffer.emplace_back(std::move(alignment));
+			stream::write_buffered(alignmentOut, buffer, AlignmentWriteChunkSize);
+		}
+		if (params.alignmentFile != "" && buffer.size() > 0) stream::write_buffered(alignmentOut, buffer, 0);
+	} };
+
+	//per-read metrics are written by their own thread in the order the reads finish
+	BoundedQueue<std::string> metricsQueue { (size_t)params.numThreads * 4 };
+	BoundedQueue<std::string>* metricsQueueToThreads = nullptr;
+	std::thread metricsThread;
+	if (params.metricsFile != "")
+	{
+		metricsQueueToThreads = &metricsQueue;
+		metricsThread = std::thread { [&metricsQueue, params]() {
+			std::ofstream metricsOut { params.metricsFile };
+			metricsOut << MetricsHeader;
+			std::string line;
+			while (metricsQueue.pop(line))
 			{
-				auto& seedhit = seeds[fastqs[i].seq_id][j];
-				seedHits[&(fastqs[i])].emplace_back(seedhit.path().mapping(0).position().node_id(), seedhit.query_position(), seedhit.path().mapping(0).position().is_reverse());
+				metricsOut << line;
 			}
-		}
-		seedHitsToThreads = &seedHits;
+		} };
 	}
 
-	std::vector<const FastQ*> readPointers;
-	std::vector<std::vector<vg::Alignment>> resultsPerThread;
-	resultsPerThread.resize(params.numThreads);
-	for (size_t i = 0; i < fastqs.size(); i++)
+	//full band and score-only scores are written like the metrics
+	BoundedQueue<std::string> scoreQueue { (size_t)params.numThreads * 4 };
+	BoundedQueue<std::string>* scoreQueueToThreads = nullptr;
+	size_t numScores = 0;
+	std::thread scoreThread;
+	if (params.fullBandScoreFile != "" || params.scoreOnlyFile != "")
 	{
-		readPointers.push_back(&(fastqs[i]));
+		scoreQueueToThreads = &scoreQueue;
+		scoreThread = std::thread { [&scoreQueue, &numScores, params]() {
+			std::ofstream scoreOut { params.fullBandScoreFile != "" ? params.fullBandScoreFile : params.scoreOnlyFile };
+			scoreOut << (params.fullBandScoreFile != "" ? FullBandScoreHeader : ScoreOnlyHeader);
+			std::string line;
+			while (scoreQueue.pop(line))
+			{
+				numScores++;
+				scoreOut << line;
+			}
+		} };
 	}
 
 	auto alignmentGraph = getGraph(params.graphFile);
 
+	SeedIndex seedIndex;
+	const SeedIndex* seedIndexToThreads = nullptr;
+	if (seedHitsToThreads == nullptr && params.seedIndexFile != "")
+	{
+		std::cout << "load seed index from " << params.seedIndexFile << std::endl;
+		seedIndex = SeedIndex::Load(params.seedIndexFile, alignmentGraph);
+		seedIndexToThreads = &seedIndex;
+	}
+	else if (seedHitsToThreads == nullptr && params.seedKmerSize > 0)
+	{
+		std::cout << "build seed index" << std::endl;
+		seedIndex = SeedIndex { alignmentGraph, (size_t)params.seedKmerSize, (size_t)params.seedSamplingRate };
+		seedIndexToThreads = &seedIndex;
+	}
+	if (seedIndexToThreads != nullptr) std::cout << seedIndex.NumKmers() << " k-mers in seed index" << std::endl;
+
+	//shared by all alignment threads for the slices with very wide bands
+	std::unique_ptr<ComponentThreadPool> componentPool;
+	if (params.componentThreads > 0) componentPool.reset(new ComponentThreadPool { (size_t)params.componentThreads });
+	ComponentThreadPool* componentPoolToThreads = componentPool.get();
+
 	std::vector<std::thread> threads;
+	std::vector<std::chrono::system_clock::time_point> threadFinishTimes;
+	threadFinishTimes.resize(params.numThreads);
 
 	assertSetRead("Running alignments");
-	std::mutex readMutex;
 
 	for (int i = 0; i < params.numThreads; i++)
 	{
-		threads.emplace_back([&alignmentGraph, &readPointers, &readMutex, &resultsPerThread, i, seedHitsToThreads, params]() { runComponentMappings(alignmentGraph, readPointers, readMutex, resultsPerThread[i], i, seedHitsToThreads, params); });
+		threads.emplace_back([&alignmentGraph, &readScheduler, &writeQueue, &scoreQueue, &threadFinishTimes, i, scoreQueueToThreads, metricsQueueToThreads, seedHitsToThreads, seedIndexToThreads, componentPoolToThreads, params]() {
+			if (params.fullBandScoreFile != "")
+			{
+				runFullBandScoring(alignmentGraph, readScheduler, scoreQueue, i);
+			}
+			else
+			{
+				runComponentMappings(alignmentGraph, readScheduler, writeQueue, params.scoreOnlyFile != "" ? scoreQueueToThreads : nullptr, metricsQueueToThreads, i, seedHitsToThreads, seedIndexToThreads, componentPoolToThreads, params);
+			}
+			threadFinishTimes[i] = std::chrono::system_clock::now();
+		});
 	}
 
+	readerThread.join();
+	std::cout << numReads << " reads" << std::endl;
+
 	for (int i = 0; i < params.numThreads; i++)
 	{
 		threads[i].join();
 	}
-	assertSetRead("Postprocessing");
-
-	std::vector<vg::Alignment> alignments;
-
+	auto lastFinishTime = *std::max_element(threadFinishTimes.begin(), threadFinishTimes.end());
 	for (int i = 0; i < params.numThreads; i++)
 	{
-		alignments.insert(alignments.end(), resultsPerThread[i].begin(), resultsPerThread[i].end());
+		size_t tailIdle = std::chrono::duration_cast<std::chrono::milliseconds>(lastFinishTime - threadFinishTimes[i]).count();
+		std::cout << "thread " << i << " waited " << readScheduler.waitTime(i) << "ms for reads and " << tailIdle << "ms at the end" << std::endl;
 	}
+	writeQueue.close();
+	writerThread.join();
+	if (metricsQueueToThreads != nullptr)
+	{
+		metricsQueue.close();
+		metricsThread.join();
+	}
+	if (scoreQueueToThreads != nullptr)
+	{
+		scoreQueue.close();
+		scoreThread.join();
+	}
+	assertSetRead("Postprocessing");
 
-	std::cerr << "final result has " << alignments.size() << " alignments" << std::endl;
-
-	if (params.alignmentFile != "")
+	if (params.scoreOnlyFile != "")
 	{
-		std::ofstream alignmentOut { params.alignmentFile, std::ios::out | std::ios::binary };
-		stream::write_buffered(alignmentOut, alignments, 0);
+		std::cerr << "final result has " << numScores << " score-only alignments" << std::endl;
 	}
+	else
+	{
+		std::cerr << "final result has " << numAlignments << " alignments" << std::endl;
+	}
+
 	if (params.auggraphFile != "")
 	{
 		vg::Graph augmentedGraphAllReads;
@@ -16,6 +16,18 @@ struct AlignerParams
 	std::string auggraphFile;
 	int dynamicRowStart;
 	std::string seedFile;
+	bool outputPerReadFiles;
+	int seedKmerSize;
+	int seedSamplingRate;
+	std::string seedIndexFile;
+	int maxSeedsPerRead;
+	int maxSeedChains;
+	double seedStopFraction;
+	std::string metricsFile;
+	std::string fullBandScoreFile;
+	std::string scoreOnlyFile;
+	int componentThreads;
+	int checkpointMemoryMB;
 };
 
 void alignReads(AlignerParams params);
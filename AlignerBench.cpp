@@ -0,0 +1,383 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/resource.h>
+#include "vg.pb.h"
+#include "CommonUtils.h"
+#include "BigraphToDigraph.h"
+#include "AlignmentGraph.h"
+#include "GraphAlignerWrapper.h"
+#include "ThreadReadAssertion.h"
+
+//end to end throughput of AlignOneWay on synthetic graphs or a given .vg graph
+//reads are simulated from the graph with the error model of SimulateReads and seeded at a node they really pass through
+//everything uses a fixed random seed so runs of different versions align the same reads
+
+const int InitialBandwidth = 10;
+const int RampBandwidth = 0;
+const size_t DynamicRowStart = 64;
+const size_t CheckpointMemoryBudget = (size_t)1024 * 1024 * 1024;
+const double SeedStopFraction = 1.0;
+const double SubstitutionRate = 0.03;
+const double InsertionRate = 0.05;
+const double DeletionRate = 0.04;
+const size_t MinNodeLength = 32;
+const size_t MaxNodeLength = 128;
+
+std::mt19937 generator { 42 };
+
+size_t randomInt(size_t min, size_t max)
+{
+	return std::uniform_int_distribution<size_t>(min, max)(generator);
+}
+
+double randomDouble()
+{
+	return std::uniform_real_distribution<double>(0.0, 1.0)(generator);
+}
+
+std::string randomSequence(size_t length)
+{
+	std::string result;
+	result.reserve(length);
+	for (size_t i = 0; i < length; i++)
+	{
+		result += "ACGT"[randomInt(0, 3)];
+	}
+	return result;
+}
+
+int addNode(vg::Graph& graph, const std::string& sequence)
+{
+	auto node = graph.add_node();
+	node->set_id(graph.node_size());
+	node->set_sequence(sequence);
+	return node->id();
+}
+
+void addEdge(vg::Graph& graph, int from, int to)
+{
+	auto edge = graph.add_edge();
+	edge->set_from(from);
+	edge->set_to(to);
+}
+
+//a single path
+vg::Graph linearGraph(size_t size)
+{
+	vg::Graph result;
+	int last = 0;
+	for (size_t length = 0; length < size; )
+	{
+		int node = addNode(result, randomSequence(randomInt(MinNodeLength, MaxNodeLength)));
+		length += result.node(node-1).sequence().size();
+		if (last != 0) addEdge(result, last, node);
+		last = node;
+	}
+	return result;
+}
+
+//a backbone with a SNP or an indel bubble between every pair of backbone nodes
+vg::Graph bubbleGraph(size_t size)
+{
+	vg::Graph result;
+	int last = 0;
+	for (size_t length = 0; length < size; )
+	{
+		int node = addNode(result, randomSequence(randomInt(MinNodeLength, MaxNodeLength)));
+		length += result.node(node-1).sequence().size();
+		if (last != 0)
+		{
+			int allele = addNode(result, randomSequence(randomInt(1, 10)));
+			addEdge(result, last, allele);
+			addEdge(result, allele, node);
+			if (randomDouble() < 0.5)
+			{
+				int otherAllele = addNode(result, randomSequence(1));
+				addEdge(result, last, otherAllele);
+				addEdge(result, otherAllele, node);
+			}
+			else
+			{
+				addEdge(result, last, node);
+			}
+		}
+		last = node;
+	}
+	return result;
+}
+
+//a backbone with tandem repeat loops and longer cycles back to earlier nodes, as in a de Bruijn graph of a repetitive genome
+vg::Graph cyclicGraph(size_t size)
+{
+	vg::Graph result;
+	int last = 0;
+	for (size_t length = 0; length < size; )
+	{
+		int node = addNode(result, randomSequence(randomInt(MinNodeLength, MaxNodeLength)));
+		length += result.node(node-1).sequence().size();
+		if (last != 0) addEdge(result, last, node);
+		double pick = randomDouble();
+		if (pick < 0.1)
+		{
+			int repeat = addNode(result, randomSequence(randomInt(2, 50)));
+			addEdge(result, node, repeat);
+			addEdge(result, repeat, repeat);
+			int next = addNode(result, randomSequence(randomInt(MinNodeLength, MaxNodeLength)));
+			addEdge(result, repeat, next);
+			length += result.node(repeat-1).sequence().size() + result.node(next-1).sequence().size();
+			node = next;
+		}
+		else if (pick < 0.2 && node > 5)
+		{
+			addEdge(result, node, node - randomInt(2, 5));
+		}
+		last = node;
+	}
+	return result;
+}
+
+struct SimulatedRead
+{
+	std::string name;
+	std::string sequence;
+	std::vector<std::tuple<int, size_t, bool>> seeds;
+};
+
+//same error model as SimulateReads, also returns where each base of the real sequence ended up
+std::string introduceErrors(const std::string& real, std::vector<size_t>& newPositions)
+{
+	std::string result;
+	newPositions.resize(real.size()+1);
+	for (size_t i = 0; i < real.size(); i++)
+	{
+		newPositions[i] = result.size();
+		if (randomDouble() < DeletionRate)
+		{
+		}
+		else
+		{
+			if (randomDouble() < SubstitutionRate)
+			{
+				result += "ATCG"[randomInt(0, 3)];
+			}
+			else
+			{
+				result += real[i];
+			}
+		}
+		if (randomDouble() < InsertionRate / 10.0)
+		{
+			size_t length = randomInt(0, 19);
+			result += randomSequence(length);
+		}
+	}
+	newPositions[real.size()] = result.size();
+	return result;
+}
+
+std::vector<SimulatedRead> simulateReads(const vg::Graph& graph, size_t numReads, size_t length)
+{
+	//oriented node is node index * 2 + reverse
+	std::unordered_map<int, size_t> ids;
+	for (int i = 0; i < graph.node_size(); i++)
+	{
+		ids[graph.node(i).id()] = i;
+	}
+	std::vector<std::vector<size_t>> outEdges;
+	outEdges.resize(graph.node_size() * 2);
+	for (int i = 0; i < graph.edge_size(); i++)
+	{
+		size_t from = ids[graph.edge(i).from()] * 2 + (graph.edge(i).from_start() ? 1 : 0);
+		size_t to = ids[graph.edge(i).to()] * 2 + (graph.edge(i).to_end() ? 1 : 0);
+		outEdges[from].push_back(to);
+		outEdges[to ^ 1].push_back(from ^ 1);
+	}
+	std::vector<SimulatedRead> result;
+	size_t failedWalks = 0;
+	while (result.size() < numReads)
+	{
+		if (failedWalks > numReads * 1000)
+		{
+			std::cerr << "could not simulate " << length << "bp reads from the graph" << std::endl;
+			std::exit(0);
+		}
+		size_t current = randomInt(0, graph.node_size() * 2 - 1);
+		std::string nodeSequence = graph.node(current / 2).sequence();
+		if (current % 2 == 1) nodeSequence = CommonUtils::ReverseComplement(nodeSequence);
+		std::string real = nodeSequence.substr(randomInt(0, nodeSequence.size()-1));
+		//the first node after the start, the read starts in the middle of the start node
+		size_t seedNode = std::numeric_limits<size_t>::max();
+		size_t seedPos = 0;
+		while (real.size() < length && outEdges[current].size() > 0)
+		{
+			current = outEdges[current][randomInt(0, outEdges[current].size()-1)];
+			if (seedNode == std::numeric_limits<size_t>::max())
+			{
+				seedNode = current;
+				seedPos = real.size();
+			}
+			nodeSequence = graph.node(current / 2).sequence();
+			if (current % 2 == 1) nodeSequence = CommonUtils::ReverseComplement(nodeSequence);
+			real += nodeSequence;
+		}
+		if (real.size() < length || seedNode == std::numeric_limits<size_t>::max() || seedPos >= length)
+		{
+			failedWalks++;
+			continue;
+		}
+		real = real.substr(0, length);
+		SimulatedRead read;
+		std::vector<size_t> newPositions;
+		read.name = "read_" + std::to_string(result.size());
+		read.sequence = introduceErrors(real, newPositions);
+		read.seeds.emplace_back(graph.node(seedNode / 2).id(), newPositions[seedPos], seedNode % 2 == 1);
+		result.push_back(std::move(read));
+	}
+	return result;
+}
+
+size_t peakRSSKilobytes()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+struct RunResult
+{
+	double seconds;
+	//summed over the threads
+	double backtraceSeconds;
+	size_t cells;
+	size_t aligned;
+};
+
+RunResult alignAll(const AlignmentGraph& graph, const std::vector<SimulatedRead>& reads, size_t numThreads)
+{
+	std::atomic<size_t> nextRead { 0 };
+	std::vector<size_t> cells;
+	std::vector<size_t> aligned;
+	std::vector<size_t> backtraceMicroseconds;
+	cells.resize(numThreads, 0);
+	aligned.resize(numThreads, 0);
+	backtraceMicroseconds.resize(numThreads, 0);
+	std::vector<std::thread> threads;
+	auto timeStart = std::chrono::system_clock::now();
+	for (size_t i = 0; i < numThreads; i++)
+	{
+		threads.emplace_back([&graph, &reads, &nextRead, &cells, &aligned, &backtraceMicroseconds, i]() {
+			AlignerWorkspace workspace { graph };
+			while (true)
+			{
+				size_t readIndex = nextRead++;
+				if (readIndex >= reads.size()) break;
+				assertSetRead(reads[readIndex].name);
+				try
+				{
+					auto alignment = AlignOneWay(graph, reads[readIndex].name, reads[readIndex].sequence, InitialBandwidth, RampBandwidth, DynamicRowStart, CheckpointMemoryBudget, SeedStopFraction, reads[readIndex].seeds, workspace);
+					cells[i] += alignment.cellsProcessed;
+					backtraceMicroseconds[i] += alignment.stats.backtraceMicroseconds;
+					if (!alignment.alignmentFailed) aligned[i]++;
+				}
+				catch (const ThreadReadAssertion::AssertionFailure& a)
+				{
+				}
+			}
+		});
+	}
+	for (size_t i = 0; i < numThreads; i++)
+	{
+		threads[i].join();
+	}
+	auto timeEnd = std::chrono::system_clock::now();
+	RunResult result;
+	result.seconds = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart).count() / 1000000.0;
+	result.backtraceSeconds = 0;
+	result.cells = 0;
+	result.aligned = 0;
+	for (size_t i = 0; i < numThreads; i++)
+	{
+		result.backtraceSeconds += backtraceMicroseconds[i] / 1000000.0;
+		result.cells += cells[i];
+		result.aligned += aligned[i];
+	}
+	return result;
+}
+
+void benchmark(const std::string& name, const vg::Graph& bigraph, size_t maxThreads, size_t numReads, size_t readLength)
+{
+	auto graph = DirectedGraph::BuildFromVG(bigraph);
+	size_t graphBp = 0;
+	for (int i = 0; i < bigraph.node_size(); i++)
+	{
+		graphBp += bigraph.node(i).sequence().size();
+	}
+	auto reads = simulateReads(bigraph, numReads, readLength);
+	size_t totalBp = 0;
+	for (const auto& read : reads)
+	{
+		totalBp += read.sequence.size();
+	}
+	std::vector<size_t> threadCounts;
+	for (size_t threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+	double singleThreadSeconds = 0;
+	for (auto threads : threadCounts)
+	{
+		auto run = alignAll(graph, reads, threads);
+		if (threads == 1) singleThreadSeconds = run.seconds;
+		std::cout << name << "\t" << graphBp << "\t" << threads << "\t" << reads.size() << "\t" << run.aligned << "\t" << run.seconds;
+		std::cout << "\t" << reads.size() / run.seconds << "\t" << totalBp / run.seconds << "\t" << run.cells / run.seconds / 1000000000.0;
+		std::cout << "\t" << singleThreadSeconds / run.seconds << "\t" << singleThreadSeconds / run.seconds / threads;
+		std::cout << "\t" << run.backtraceSeconds << "\t" << peakRSSKilobytes() / 1024 << std::endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		std::cerr << "usage: AlignerBench maxthreads numreads readlength [graphsize|graph.vg ...]" << std::endl;
+		std::cerr << "a graph size generates a linear, a bubble and a cyclic graph of that many bp, default 100000" << std::endl;
+		std::cerr << "results are written to stdout, the aligner's log to stderr" << std::endl;
+		std::exit(0);
+	}
+	size_t maxThreads = std::stoi(argv[1]);
+	size_t numReads = std::stoi(argv[2]);
+	size_t readLength = std::stoi(argv[3]);
+	if (maxThreads < 1 || numReads < 1 || readLength < 1)
+	{
+		std::cerr << "threads, reads and read length must be >= 1" << std::endl;
+		std::exit(0);
+	}
+	std::vector<std::string> graphs;
+	for (int i = 4; i < argc; i++)
+	{
+		graphs.emplace_back(argv[i]);
+	}
+	if (graphs.size() == 0) graphs.emplace_back("100000");
+	//peak RSS is of the whole process so far, not of one run
+	std::cout << "graph\tbp\tthreads\treads\taligned\tseconds\treads/s\tbp/s\tGCUPS\tspeedup\tefficiency\tbacktrace_s\tpeakRSS_MB" << std::endl;
+	for (auto graph : graphs)
+	{
+		if (graph.size() > 3 && graph.substr(graph.size()-3) == ".vg")
+		{
+			benchmark(graph, CommonUtils::LoadVGGraph(graph), maxThreads, numReads, readLength);
+			continue;
+		}
+		size_t size = std::stoull(graph);
+		benchmark("linear", linearGraph(size), maxThreads, numReads, readLength);
+		benchmark("bubble", bubbleGraph(size), maxThreads, numReads, readLength);
+		benchmark("cyclic", cyclicGraph(size), maxThreads, numReads, readLength);
+	}
+}
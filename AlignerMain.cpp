@@ -25,10 +25,22 @@ int main(int argc, char** argv)
 	params.initialBandwidth = 0;
 	params.rampBandwidth = 0;
 	params.dynamicRowStart = 64;
+	params.outputPerReadFiles = false;
+	params.seedKmerSize = 0;
+	params.seedSamplingRate = 8;
+	params.seedIndexFile = "";
+	params.maxSeedsPerRead = 5;
+	params.maxSeedChains = 0;
+	params.seedStopFraction = 1.0;
+	params.metricsFile = "";
+	params.fullBandScoreFile = "";
+	params.scoreOnlyFile = "";
+	params.componentThreads = 0;
+	params.checkpointMemoryMB = 1024;
 	bool initialFullBand = false;
 	int c;
 
-	while ((c = getopt(argc, argv, "g:f:a:t:B:A:is:d:MSb:")) != -1)
+	while ((c = getopt(argc, argv, "g:f:a:t:B:A:is:d:MSb:Dk:w:x:n:c:e:m:F:E:P:C:")) != -1)
 	{
 		switch(c)
 		{
@@ -62,6 +74,55 @@ int main(int argc, char** argv)
 			case 'd':
 				params.dynamicRowStart = std::stoi(optarg);
 				break;
+			case 'D':
+				//debug output: alignment_*.gam and trace_*.trace for every read
+				params.outputPerReadFiles = true;
+				break;
+			case 'k':
+				//build a seed index with this k-mer size instead of reading seeds from a file
+				params.seedKmerSize = std::stoi(optarg);
+				break;
+			case 'w':
+				//seed index keeps one in this many k-mers
+				params.seedSamplingRate = std::stoi(optarg);
+				break;
+			case 'x':
+				//seed index built by BuildIndex
+				params.seedIndexFile = std::string(optarg);
+				break;
+			case 'n':
+				params.maxSeedsPerRead = std::stoi(optarg);
+				break;
+			case 'c':
+				//seeds are chained by their read and graph distances, only the first seed of this many of the best chains is extended, 0 extends every seed
+				params.maxSeedChains = std::stoi(optarg);
+				break;
+			case 'e':
+				//don't extend a seed if the best alignment so far aligns this fraction of what the seed could align
+				//1 skips only the seeds which can't give a better alignment, 0 extends every seed
+				params.seedStopFraction = std::stod(optarg);
+				break;
+			case 'm':
+				//tab separated per-read counters and timings
+				params.metricsFile = std::string(optarg);
+				break;
+			case 'F':
+				//only score the reads against the whole graph without a band, several reads at once.
+				//no alignments, only the score and the end position, and the time is graph size * read length
+				params.fullBandScoreFile = std::string(optarg);
+				break;
+			case 'E':
+				//only the forward pass from the seeds, write the scores and the start and end positions instead of alignments
+				params.scoreOnlyFile = std::string(optarg);
+				break;
+			case 'P':
+				//extra threads shared by all reads for splitting very wide bands of one read
+				params.componentThreads = std::stoi(optarg);
+				break;
+			case 'C':
+				//megabytes of stored DP slices per alignment thread, less memory means more recalculation in the backtrace
+				params.checkpointMemoryMB = std::stoi(optarg);
+				break;
 		}
 	}
 
@@ -77,7 +138,7 @@ int main(int argc, char** argv)
 		std::exit(0);
 	}
 
-	if (params.initialBandwidth < 2)
+	if (params.fullBandScoreFile == "" && params.initialBandwidth < 2)
 	{
 		std::cerr << "bandwidth must be >= 2" << std::endl;
 		std::exit(0);
@@ -89,9 +150,63 @@ int main(int argc, char** argv)
 		std::exit(0);
 	}
 
-	if (!initialFullBand && params.seedFile == "")
+	if (params.seedKmerSize < 0 || params.seedKmerSize > 31)
+	{
+		std::cerr << "seed k-mer size must be between 1 and 31" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.seedSamplingRate < 1)
+	{
+		std::cerr << "seed sampling rate must be >= 1" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.maxSeedsPerRead < 1)
+	{
+		std::cerr << "max seeds per read must be >= 1" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.maxSeedChains < 0)
+	{
+		std::cerr << "max seed chains per read must be >= 0" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.seedStopFraction < 0)
+	{
+		std::cerr << "seed stop fraction must be >= 0" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.componentThreads < 0)
+	{
+		std::cerr << "number of component threads must be >= 0" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.checkpointMemoryMB < 0)
+	{
+		std::cerr << "checkpoint memory must be >= 0" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.scoreOnlyFile != "" && params.fullBandScoreFile != "")
+	{
+		std::cerr << "score-only alignment and full band scoring can't be used together" << std::endl;
+		std::exit(0);
+	}
+
+	if (params.scoreOnlyFile != "" && params.seedFile == "" && params.seedKmerSize == 0 && params.seedIndexFile == "")
+	{
+		std::cerr << "score-only alignment needs a seed file or seed index" << std::endl;
+		std::exit(0);
+	}
+
+	if (!initialFullBand && params.seedFile == "" && params.seedKmerSize == 0 && params.seedIndexFile == "" && params.fullBandScoreFile == "")
 	{
-		std::cerr << "either initial full band or seed file must be set" << std::endl;
+		std::cerr << "either initial full band, seed file or seed index must be set" << std::endl;
 		std::exit(0);
 	}
 
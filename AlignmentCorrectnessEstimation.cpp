@@ -70,6 +70,19 @@ double AlignmentCorrectnessEstimationState::FalseLogOdds() const
 
 AlignmentCorrectnessEstimationState AlignmentCorrectnessEstimationState::NextState(int mismatches, int rowSize) const
 {
+	//the transition probabilities are per 64 rows, so wide slices are split into 64 row steps
+	//with the mismatches spread evenly
+	if (rowSize > 64)
+	{
+		assert(rowSize % 64 == 0);
+		int steps = rowSize / 64;
+		AlignmentCorrectnessEstimationState result = *this;
+		for (int i = 0; i < steps; i++)
+		{
+			result = result.NextState(mismatches * (i + 1) / steps - mismatches * i / steps, 64);
+		}
+		return result;
+	}
 	assert(rowSize == 64 || rowSize == 1);
 	assert(mismatches >= 0);
 	assert(mismatches <= rowSize);
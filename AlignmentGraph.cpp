@@ -6,8 +6,11 @@
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
 #include <queue>
+#include <cctype>
 #include "AlignmentGraph.h"
 #include "CommonUtils.h"
+#include "IndexFormat.h"
+#include "WordSlice.h"
 
 AlignmentGraph::AlignmentGraph() :
 DBGOverlap(0),
@@ -15,33 +18,57 @@ nodeStart(),
 nodeLookup(),
 nodeIDs(),
 inNeighbors(),
-nodeSequencesATorCG(),
-nodeSequencesACorTG(),
-finalized(false)
+outNeighbors(),
+reverse(),
+nodeSequences(),
+ambiguousPositions(),
+ambiguousBases(),
+ambiguousNodes(),
+componentNumber(),
+nodeStartRanks(),
+sequenceLength(0),
+finalized(false),
+mappedIndex()
 {
 	//add the start dummy node as the first node
 	dummyNodeStart = 0;
-	nodeIDs.push_back(0);
-	nodeStart.push_back(0);
-	inNeighbors.emplace_back();
-	outNeighbors.emplace_back();
-	reverse.push_back(false);
-	nodeSequencesATorCG.push_back(false);
-	nodeSequencesACorTG.push_back(false);
+	buildNodeIDs.push_back(0);
+	buildNodeStart.push_back(0);
+	buildInNeighbors.emplace_back();
+	buildOutNeighbors.emplace_back();
+	buildReverse.push_back(false);
+	AddBase(0);
 }
 
 void AlignmentGraph::ReserveNodes(size_t numNodes, size_t sequenceLength)
 {
 	numNodes += 2; //dummy start and end nodes
 	sequenceLength += 2; //dummy start and end nodes
-	nodeSequencesATorCG.reserve(sequenceLength);
-	nodeSequencesACorTG.reserve(sequenceLength);
-	nodeLookup.reserve(numNodes);
-	nodeIDs.reserve(numNodes);
-	nodeStart.reserve(numNodes);
-	inNeighbors.reserve(numNodes);
-	outNeighbors.reserve(numNodes);
-	reverse.reserve(numNodes);
+	buildSequences.reserve((sequenceLength + 31) / 32 + 1);
+	buildNodeLookup.reserve(numNodes);
+	buildNodeIDs.reserve(numNodes);
+	buildNodeStart.reserve(numNodes);
+	buildInNeighbors.reserve(numNodes);
+	buildOutNeighbors.reserve(numNodes);
+	buildReverse.reserve(numNodes);
+}
+
+void AlignmentGraph::AddBase(uint64_t code)
+{
+	assert(code < 4);
+	if (sequenceLength % 32 == 0)
+	{
+		buildSequences.push_back(0);
+	}
+	buildSequences.back() |= code << (2 * (sequenceLength % 32));
+	sequenceLength++;
+}
+
+void AlignmentGraph::AddAmbiguousBase(char base)
+{
+	buildAmbiguousPositions.push_back(sequenceLength);
+	buildAmbiguousBases.push_back(base);
+	AddBase(0);
 }
 
 void AlignmentGraph::AddNode(int nodeId, const std::string& sequence, bool reverseNode)
@@ -49,113 +76,301 @@ void AlignmentGraph::AddNode(int nodeId, const std::string& sequence, bool rever
 	assert(!finalized);
 	//subgraph extraction might produce different subgraphs with common nodes
 	//don't add duplicate nodes
-	if (nodeLookup.count(nodeId) != 0) return;
-
-	assert(std::numeric_limits<size_t>::max() - sequence.size() > nodeSequencesATorCG.size());
-	nodeLookup[nodeId] = nodeStart.size();
-	nodeIDs.push_back(nodeId);
-	nodeStart.push_back(nodeSequencesATorCG.size());
-	inNeighbors.emplace_back();
-	outNeighbors.emplace_back();
-	reverse.push_back(reverseNode);
+	if (buildNodeLookup.count(nodeId) != 0) return;
+
+	assert(std::numeric_limits<size_t>::max() - sequence.size() > sequenceLength);
+	buildNodeLookup[nodeId] = buildNodeStart.size();
+	buildNodeIDs.push_back(nodeId);
+	buildNodeStart.push_back(sequenceLength);
+	buildInNeighbors.emplace_back();
+	buildOutNeighbors.emplace_back();
+	buildReverse.push_back(reverseNode);
 	for (auto c : sequence)
 	{
 		switch(c)
 		{
 			case 'A':
-				nodeSequencesATorCG.push_back(false);
-				nodeSequencesACorTG.push_back(false);
+			case 'a':
+				AddBase(0);
 				break;
 			case 'T':
-				nodeSequencesATorCG.push_back(false);
-				nodeSequencesACorTG.push_back(true);
+			case 't':
+				AddBase(1);
 				break;
 			case 'C':
-				nodeSequencesATorCG.push_back(true);
-				nodeSequencesACorTG.push_back(false);
+			case 'c':
+				AddBase(2);
 				break;
 			case 'G':
-				nodeSequencesATorCG.push_back(true);
-				nodeSequencesACorTG.push_back(true);
+			case 'g':
+				AddBase(3);
+				break;
+			case 'N':
+			case 'n':
+			case 'R':
+			case 'r':
+			case 'Y':
+			case 'y':
+			case 'K':
+			case 'k':
+			case 'M':
+			case 'm':
+			case 'S':
+			case 's':
+			case 'W':
+			case 'w':
+			case 'B':
+			case 'b':
+			case 'D':
+			case 'd':
+			case 'H':
+			case 'h':
+			case 'V':
+			case 'v':
+				AddAmbiguousBase(toupper(c));
 				break;
 			default:
 				assert(false);
 				std::abort();
 		}
 	}
-	assert(nodeIDs.size() == nodeStart.size());
-	assert(nodeStart.size() == inNeighbors.size());
-	assert(inNeighbors.size() == outNeighbors.size());
+	assert(buildNodeIDs.size() == buildNodeStart.size());
+	assert(buildNodeStart.size() == buildInNeighbors.size());
+	assert(buildInNeighbors.size() == buildOutNeighbors.size());
 }
 
 void AlignmentGraph::AddEdgeNodeId(int node_id_from, int node_id_to)
 {
 	assert(!finalized);
-	assert(nodeLookup.count(node_id_from) > 0);
-	assert(nodeLookup.count(node_id_to) > 0);
-	auto from = nodeLookup[node_id_from];
-	auto to = nodeLookup[node_id_to];
+	assert(buildNodeLookup.count(node_id_from) > 0);
+	assert(buildNodeLookup.count(node_id_to) > 0);
+	auto from = buildNodeLookup[node_id_from];
+	auto to = buildNodeLookup[node_id_to];
 	assert(to >= 0);
 	assert(from >= 0);
-	assert(to < inNeighbors.size());
-	assert(from < nodeStart.size());
+	assert(to < buildInNeighbors.size());
+	assert(from < buildNodeStart.size());
 
 	//don't add double edges
-	if (std::find(inNeighbors[to].begin(), inNeighbors[to].end(), from) == inNeighbors[to].end()) inNeighbors[to].push_back(from);
-	if (std::find(outNeighbors[from].begin(), outNeighbors[from].end(), to) == outNeighbors[from].end()) outNeighbors[from].push_back(to);
+	if (std::find(buildInNeighbors[to].begin(), buildInNeighbors[to].end(), from) == buildInNeighbors[to].end()) buildInNeighbors[to].push_back(from);
+	if (std::find(buildOutNeighbors[from].begin(), buildOutNeighbors[from].end(), to) == buildOutNeighbors[from].end()) buildOutNeighbors[from].push_back(to);
+}
+
+void flattenNeighbors(std::vector<std::vector<size_t>>& lists, FlatArray<size_t>& start, FlatArray<size_t>& neighbors)
+{
+	std::vector<size_t> flatStart;
+	std::vector<size_t> flatNeighbors;
+	flatStart.reserve(lists.size()+1);
+	for (size_t i = 0; i < lists.size(); i++)
+	{
+		flatStart.push_back(flatNeighbors.size());
+		flatNeighbors.insert(flatNeighbors.end(), lists[i].begin(), lists[i].end());
+	}
+	flatStart.push_back(flatNeighbors.size());
+	start.assign(std::move(flatStart));
+	neighbors.assign(std::move(flatNeighbors));
+	lists.clear();
+	lists.shrink_to_fit();
 }
 
 void AlignmentGraph::Finalize(int wordSize)
 {
 	//add the end dummy node as the last node
-	dummyNodeEnd = nodeSequencesATorCG.size();
-	nodeIDs.push_back(0);
-	nodeStart.push_back(nodeSequencesATorCG.size());
-	reverse.push_back(false);
-	inNeighbors.emplace_back();
-	outNeighbors.emplace_back();
-	nodeSequencesATorCG.push_back(false);
-	nodeSequencesACorTG.push_back(false);
-	assert(nodeSequencesATorCG.size() == nodeSequencesACorTG.size());
-	assert(nodeSequencesATorCG.size() >= nodeStart.size());
-	assert(inNeighbors.size() == nodeStart.size());
-	assert(outNeighbors.size() == nodeStart.size());
-	assert(reverse.size() == nodeStart.size());
-	assert(nodeIDs.size() == nodeStart.size());
-	std::cerr << nodeStart.size() << " nodes" << std::endl;
-	std::cerr << nodeSequencesATorCG.size() << "bp" << std::endl;
+	dummyNodeEnd = sequenceLength;
+	buildNodeIDs.push_back(0);
+	buildNodeStart.push_back(sequenceLength);
+	buildReverse.push_back(false);
+	buildInNeighbors.emplace_back();
+	buildOutNeighbors.emplace_back();
+	AddBase(0);
+	buildSequences.push_back(0);
+	assert(buildSequences.size() == (sequenceLength + 31) / 32 + 1);
+	assert(buildAmbiguousPositions.size() == buildAmbiguousBases.size());
+	assert(sequenceLength >= buildNodeStart.size());
+	assert(buildInNeighbors.size() == buildNodeStart.size());
+	assert(buildOutNeighbors.size() == buildNodeStart.size());
+	assert(buildReverse.size() == buildNodeStart.size());
+	assert(buildNodeIDs.size() == buildNodeStart.size());
+	std::vector<std::pair<int, size_t>> lookup { buildNodeLookup.begin(), buildNodeLookup.end() };
+	buildNodeLookup.clear();
+	std::sort(lookup.begin(), lookup.end());
+	std::vector<int> lookupIds;
+	std::vector<size_t> lookupIndices;
+	lookupIds.reserve(lookup.size());
+	lookupIndices.reserve(lookup.size());
+	for (auto pair : lookup)
+	{
+		lookupIds.push_back(pair.first);
+		lookupIndices.push_back(pair.second);
+	}
+	nodeLookup.ids.assign(std::move(lookupIds));
+	nodeLookup.indices.assign(std::move(lookupIndices));
+	nodeStart.assign(std::move(buildNodeStart));
+	nodeIDs.assign(std::move(buildNodeIDs));
+	reverse.assign(std::move(buildReverse));
+	flattenNeighbors(buildInNeighbors, inNeighbors.start, inNeighbors.neighbors);
+	flattenNeighbors(buildOutNeighbors, outNeighbors.start, outNeighbors.neighbors);
+	nodeSequences.assign(std::move(buildSequences));
+	ambiguousPositions.assign(std::move(buildAmbiguousPositions));
+	ambiguousBases.assign(std::move(buildAmbiguousBases));
+	CalculateAmbiguousNodes();
+	CalculateComponents();
+	CalculateNodeStartRanks();
 	finalized = true;
+	PrintStats();
+}
+
+//https://en.wikipedia.org/wiki/Tarjan%27s_strongly_connected_components_algorithm
+//with an explicit stack so long chains of nodes don't overflow the call stack
+void AlignmentGraph::CalculateComponents()
+{
+	const size_t unvisited = std::numeric_limits<size_t>::max();
+	size_t numNodes = nodeStart.size();
+	std::vector<size_t> index(numNodes, unvisited);
+	std::vector<size_t> lowLink(numNodes, 0);
+	std::vector<bool> onStack(numNodes, false);
+	std::vector<size_t> stack;
+	//node and the position of the next neighbor to visit
+	std::vector<std::pair<size_t, size_t>> callStack;
+	//tarjan finds the components in reverse topological order, reversed at the end
+	std::vector<size_t> foundOrder(numNodes, 0);
+	size_t nextIndex = 0;
+	size_t numComponents = 0;
+	for (size_t start = 0; start < numNodes; start++)
+	{
+		if (index[start] != unvisited) continue;
+		callStack.emplace_back(start, 0);
+		while (callStack.size() > 0)
+		{
+			size_t node = callStack.back().first;
+			size_t neighborIndex = callStack.back().second;
+			if (neighborIndex == 0 && index[node] == unvisited)
+			{
+				index[node] = nextIndex;
+				lowLink[node] = nextIndex;
+				nextIndex++;
+				stack.push_back(node);
+				onStack[node] = true;
+			}
+			auto neighbors = outNeighbors[node];
+			if (neighborIndex < neighbors.size())
+			{
+				size_t neighbor = neighbors.begin()[neighborIndex];
+				callStack.back().second++;
+				if (index[neighbor] == unvisited)
+				{
+					callStack.emplace_back(neighbor, 0);
+				}
+				else if (onStack[neighbor])
+				{
+					lowLink[node] = std::min(lowLink[node], index[neighbor]);
+				}
+				continue;
+			}
+			callStack.pop_back();
+			if (callStack.size() > 0)
+			{
+				size_t parent = callStack.back().first;
+				lowLink[parent] = std::min(lowLink[parent], lowLink[node]);
+			}
+			if (lowLink[node] == index[node])
+			{
+				size_t back;
+				do
+				{
+					back = stack.back();
+					stack.pop_back();
+					onStack[back] = false;
+					foundOrder[back] = numComponents;
+				} while (back != node);
+				numComponents++;
+			}
+		}
+	}
+	assert(stack.size() == 0);
+	std::vector<size_t> result;
+	result.reserve(numNodes);
+	for (size_t i = 0; i < numNodes; i++)
+	{
+		result.push_back(numComponents - 1 - foundOrder[i]);
+	}
+#ifndef NDEBUG
+	for (size_t i = 0; i < numNodes; i++)
+	{
+		for (auto neighbor : outNeighbors[i])
+		{
+			assert(result[neighbor] >= result[i]);
+		}
+	}
+#endif
+	componentNumber.assign(std::move(result));
+}
+
+void AlignmentGraph::CalculateAmbiguousNodes()
+{
+	std::vector<uint8_t> result;
+	if (ambiguousPositions.size() > 0)
+	{
+		result.resize(nodeStart.size(), 0);
+		//both the positions and the node starts are sorted
+		size_t node = 0;
+		for (auto pos : ambiguousPositions)
+		{
+			while (NodeEnd(node) <= pos) node++;
+			result[node] = 1;
+		}
+	}
+	ambiguousNodes.assign(std::move(result));
+}
+
+const size_t NodeStartRankBlockBits = 512;
+const size_t NodeStartRankBlockWords = 10;
+
+void AlignmentGraph::CalculateNodeStartRanks()
+{
+	size_t numBlocks = (sequenceLength + NodeStartRankBlockBits - 1) / NodeStartRankBlockBits;
+	std::vector<uint64_t> result(numBlocks * NodeStartRankBlockWords, 0);
+	for (size_t i = 0; i < nodeStart.size(); i++)
+	{
+		size_t pos = nodeStart[i];
+		assert(pos < sequenceLength);
+		//nodes aren't empty so each start has one bit
+		assert(i == 0 || pos > nodeStart[i-1]);
+		result[pos / NodeStartRankBlockBits * NodeStartRankBlockWords + 2 + pos % NodeStartRankBlockBits / 64] |= ((uint64_t)1) << (pos % 64);
+	}
+	size_t rank = 0;
+	for (size_t block = 0; block < numBlocks; block++)
+	{
+		uint64_t* words = result.data() + block * NodeStartRankBlockWords;
+		words[0] = rank;
+		size_t inBlock = 0;
+		for (size_t word = 0; word < 8; word++)
+		{
+			if (word > 0) words[1] |= ((uint64_t)inBlock) << (9 * (word - 1));
+			inBlock += WordConfiguration<uint64_t>::popcount(words[2 + word]);
+		}
+		rank += inBlock;
+	}
+	assert(rank == nodeStart.size());
+	nodeStartRanks.assign(std::move(result));
+}
+
+void AlignmentGraph::PrintStats() const
+{
+	std::cerr << nodeStart.size() << " nodes" << std::endl;
+	std::cerr << sequenceLength << "bp" << std::endl;
 	int specialNodes = 0;
-	size_t edges = 0;
 	for (size_t i = 0; i < inNeighbors.size(); i++)
 	{
-		inNeighbors[i].shrink_to_fit();
-		outNeighbors[i].shrink_to_fit();
 		if (inNeighbors[i].size() >= 2) specialNodes++;
-		edges += inNeighbors[i].size();
 	}
-	std::cerr << edges << " edges" << std::endl;
+	std::cerr << inNeighbors.neighbors.size() << " edges" << std::endl;
 	std::cerr << specialNodes << " nodes with in-degree >= 2" << std::endl;
-#ifndef NDEBUG
-	assert(nodeSequencesATorCG.size() == nodeSequencesACorTG.size());
-	assert(nodeSequencesATorCG.size() >= nodeStart.size());
-	assert(inNeighbors.size() == nodeStart.size());
-	assert(outNeighbors.size() == nodeStart.size());
-	assert(reverse.size() == nodeStart.size());
-	assert(nodeIDs.size() == nodeStart.size());
-#endif
-	nodeStart.shrink_to_fit();
-	nodeIDs.shrink_to_fit();
-	inNeighbors.shrink_to_fit();
-	outNeighbors.shrink_to_fit();
-	reverse.shrink_to_fit();
-	nodeSequencesATorCG.shrink_to_fit();
-	nodeSequencesACorTG.shrink_to_fit();
 }
 
 size_t AlignmentGraph::SizeInBp() const
 {
-	return nodeSequencesATorCG.size();
+	return sequenceLength;
 }
 
 std::set<size_t> AlignmentGraph::ProjectForward(const std::set<size_t>& startpositions, size_t amount) const
@@ -215,7 +430,7 @@ size_t AlignmentGraph::GetReverseNode(size_t nodeIndex) const
 
 size_t AlignmentGraph::GetReversePosition(size_t pos) const
 {
-	assert(pos < nodeSequencesATorCG.size());
+	assert(pos < sequenceLength);
 	assert(pos > 0);
 	auto originalNode = IndexToNode(pos);
 	auto otherNode = GetReverseNode(originalNode);
@@ -223,14 +438,21 @@ size_t AlignmentGraph::GetReversePosition(size_t pos) const
 	return newPos;
 }
 
+//number of node starts at or before index, minus one
 size_t AlignmentGraph::IndexToNode(size_t index) const
 {
-	assert(index < nodeSequencesATorCG.size());
-	auto nextnode = std::upper_bound(nodeStart.begin(), nodeStart.end(), index);
-	auto nextindex = nextnode - nodeStart.begin();
-	assert(nextindex > 0);
-	assert(nextindex <= nodeStart.size());
-	return nextindex-1;
+	assert(index < sequenceLength);
+	const uint64_t* block = nodeStartRanks.data() + index / NodeStartRankBlockBits * NodeStartRankBlockWords;
+	size_t word = index % NodeStartRankBlockBits / 64;
+	//the top bit of the in-block counts is zero so the first word can shift by 63
+	size_t before = block[0] + ((block[1] >> (word == 0 ? 63 : 9 * (word - 1))) & 0x1FF);
+	size_t result = before + WordConfiguration<uint64_t>::popcount(block[2 + word] & (WordConfiguration<uint64_t>::AllOnes >> (63 - index % 64))) - 1;
+	assert(result < nodeStart.size());
+#ifdef EXTRACORRECTNESSASSERTIONS
+	assert(nodeStart[result] <= index);
+	assert(result + 1 == nodeStart.size() || nodeStart[result+1] > index);
+#endif
+	return result;
 }
 
 size_t AlignmentGraph::NodeStart(size_t index) const
@@ -240,7 +462,7 @@ size_t AlignmentGraph::NodeStart(size_t index) const
 
 size_t AlignmentGraph::NodeEnd(size_t index) const
 {
-	if (index == nodeStart.size()-1) return nodeSequencesATorCG.size();
+	if (index == nodeStart.size()-1) return sequenceLength;
 	return nodeStart[index+1];
 }
 
@@ -251,17 +473,36 @@ size_t AlignmentGraph::NodeLength(size_t index) const
 
 char AlignmentGraph::NodeSequences(size_t index) const
 {
-	assert(index < nodeSequencesATorCG.size());
+	assert(index < sequenceLength);
 	//dummy nodes
-	if (index == 0 || index == nodeSequencesACorTG.size()-1) return '-';
-	int first = nodeSequencesATorCG[index];
-	int second = nodeSequencesACorTG[index];
-	return "ATCG"[first*2+second];
+	if (index == 0 || index == sequenceLength-1) return '-';
+	//most nodes have no ambiguous bases so check the node before searching the positions
+	if (ambiguousNodes.size() > 0 && ambiguousNodes[IndexToNode(index)])
+	{
+		auto found = std::lower_bound(ambiguousPositions.begin(), ambiguousPositions.end(), index);
+		if (found != ambiguousPositions.end() && *found == index) return ambiguousBases[found - ambiguousPositions.begin()];
+	}
+	return "ATCG"[(nodeSequences[index / 32] >> (2 * (index % 32))) & 3];
+}
+
+uint64_t AlignmentGraph::NodeSequenceCodes(size_t index) const
+{
+	assert(index < sequenceLength);
+	size_t word = index / 32;
+	size_t offset = index % 32;
+	if (offset == 0) return nodeSequences[word];
+	return (nodeSequences[word] >> (2 * offset)) | (nodeSequences[word + 1] << (64 - 2 * offset));
+}
+
+bool AlignmentGraph::NodeHasAmbiguousBases(size_t nodeIndex) const
+{
+	if (ambiguousNodes.size() == 0) return false;
+	return ambiguousNodes[nodeIndex];
 }
 
 size_t AlignmentGraph::NodeSequencesSize() const
 {
-	return nodeSequencesACorTG.size();
+	return sequenceLength;
 }
 
 size_t AlignmentGraph::NodeSize() const
@@ -361,4 +602,87 @@ size_t AlignmentGraph::MinDistance(size_t pos, const std::vector<size_t>& target
 		}
 	}
 	return mindist;
+}
+size_t AlignmentGraph::NodeLookup::at(int nodeId) const
+{
+	auto found = std::lower_bound(ids.begin(), ids.end(), nodeId);
+	if (found == ids.end() || *found != nodeId) throw std::out_of_range { "node " + std::to_string(nodeId) + " not in graph" };
+	return indices[found - ids.begin()];
+}
+
+size_t AlignmentGraph::NodeLookup::count(int nodeId) const
+{
+	return std::binary_search(ids.begin(), ids.end(), nodeId) ? 1 : 0;
+}
+
+const char GraphIndexMagic[8] = { 'G', 'A', 'I', 'N', 'D', 'E', 'X', 0 };
+//version 2: 2-bit packed sequences and ambiguous bases
+//version 3: strongly connected components
+//version 4: rank index of the node starts
+//version 5: nodes with ambiguous bases
+const uint64_t GraphIndexVersion = 5;
+
+void AlignmentGraph::SaveIndex(std::string filename) const
+{
+	assert(finalized);
+	IndexFormat::Writer writer { filename, GraphIndexMagic, GraphIndexVersion };
+	writer.scalar(sequenceLength);
+	writer.scalar(dummyNodeStart);
+	writer.scalar(dummyNodeEnd);
+	writer.scalar((uint64_t)(int64_t)DBGOverlap);
+	writer.array(nodeStart);
+	writer.array(nodeIDs);
+	writer.array(reverse);
+	writer.array(inNeighbors.start);
+	writer.array(inNeighbors.neighbors);
+	writer.array(outNeighbors.start);
+	writer.array(outNeighbors.neighbors);
+	writer.array(nodeLookup.ids);
+	writer.array(nodeLookup.indices);
+	writer.array(nodeSequences);
+	writer.array(ambiguousPositions);
+	writer.array(ambiguousBases);
+	writer.array(ambiguousNodes);
+	writer.array(componentNumber);
+	writer.array(nodeStartRanks);
+	writer.finish();
+}
+
+AlignmentGraph AlignmentGraph::LoadIndex(std::string filename)
+{
+	IndexFormat::Reader reader { filename, GraphIndexMagic, GraphIndexVersion };
+	AlignmentGraph result;
+	uint64_t dbgOverlap;
+	reader.scalar(result.sequenceLength);
+	reader.scalar(result.dummyNodeStart);
+	reader.scalar(result.dummyNodeEnd);
+	reader.scalar(dbgOverlap);
+	reader.array(result.nodeStart);
+	reader.array(result.nodeIDs);
+	reader.array(result.reverse);
+	reader.array(result.inNeighbors.start);
+	reader.array(result.inNeighbors.neighbors);
+	reader.array(result.outNeighbors.start);
+	reader.array(result.outNeighbors.neighbors);
+	reader.array(result.nodeLookup.ids);
+	reader.array(result.nodeLookup.indices);
+	reader.array(result.nodeSequences);
+	reader.array(result.ambiguousPositions);
+	reader.array(result.ambiguousBases);
+	reader.array(result.ambiguousNodes);
+	reader.array(result.componentNumber);
+	reader.array(result.nodeStartRanks);
+	result.mappedIndex = reader.mapping();
+	result.DBGOverlap = (int)(int64_t)dbgOverlap;
+	result.buildNodeIDs.clear();
+	result.buildNodeStart.clear();
+	result.buildInNeighbors.clear();
+	result.buildOutNeighbors.clear();
+	result.buildReverse.clear();
+	result.buildSequences.clear();
+	result.buildAmbiguousPositions.clear();
+	result.buildAmbiguousBases.clear();
+	result.finalized = true;
+	result.PrintStats();
+	return result;
 }
\ No newline at end of file
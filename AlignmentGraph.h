@@ -1,12 +1,15 @@
 #ifndef AlignmentGraph_h
 #define AlignmentGraph_h
 
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <set>
 #include <unordered_map>
 #include <tuple>
 #include "ThreadReadAssertion.h"
+#include "FlatArray.h"
 
 class CycleCutCalculation;
 
@@ -14,6 +17,43 @@ class AlignmentGraph
 {
 public:
 	typedef std::pair<size_t, size_t> MatrixPosition;
+	class NeighborRange
+	{
+	public:
+		NeighborRange(const size_t* first, const size_t* last) : first(first), last(last) {};
+		const size_t* begin() const { return first; }
+		const size_t* end() const { return last; }
+		size_t size() const { return last - first; }
+	private:
+		const size_t* first;
+		const size_t* last;
+	};
+	//neighbors of node i are neighbors[start[i]] to neighbors[start[i+1]]
+	class AdjacencyList
+	{
+	public:
+		NeighborRange operator[](size_t node) const
+		{
+			assert(node + 1 < start.size());
+			return NeighborRange { neighbors.data() + start[node], neighbors.data() + start[node+1] };
+		}
+		size_t size() const { return start.size() - 1; }
+	private:
+		FlatArray<size_t> start;
+		FlatArray<size_t> neighbors;
+		friend class AlignmentGraph;
+	};
+	//node id to node index, sorted by node id
+	class NodeLookup
+	{
+	public:
+		size_t at(int nodeId) const;
+		size_t count(int nodeId) const;
+	private:
+		FlatArray<int> ids;
+		FlatArray<size_t> indices;
+		friend class AlignmentGraph;
+	};
 	class SeedHit
 	{
 	public:
@@ -36,27 +76,69 @@ public:
 	size_t NodeEnd(size_t nodeIndex) const;
 	size_t NodeLength(size_t nodeIndex) const;
 	char NodeSequences(size_t index) const;
+	//2-bit codes (A=0, T=1, C=2, G=3) of the 32 bases starting at index, the base at index in the lowest bits
+	//ambiguous bases don't have a code, use NodeSequences for nodes with NodeHasAmbiguousBases
+	uint64_t NodeSequenceCodes(size_t index) const;
+	bool NodeHasAmbiguousBases(size_t nodeIndex) const;
 	size_t NodeSequencesSize() const;
 	size_t MinDistance(size_t pos, const std::vector<size_t>& targets) const;
 	std::set<size_t> ProjectForward(const std::set<size_t>& startpositions, size_t amount) const;
 	std::vector<MatrixPosition> GetSeedHitPositionsInMatrix(const std::string& sequence, const std::vector<SeedHit>& seedHits) const;
+	//binary index of a finalized graph, loaded with mmap and used without parsing
+	void SaveIndex(std::string filename) const;
+	static AlignmentGraph LoadIndex(std::string filename);
 	int DBGOverlap;
 
 private:
-	std::vector<size_t> nodeStart;
-	std::unordered_map<int, size_t> nodeLookup;
-	std::vector<int> nodeIDs;
-	std::vector<std::vector<size_t>> inNeighbors;
-	std::vector<std::vector<size_t>> outNeighbors;
-	std::vector<bool> reverse;
-	std::vector<bool> nodeSequencesATorCG;
-	std::vector<bool> nodeSequencesACorTG;
+	void AddBase(uint64_t code);
+	void AddAmbiguousBase(char base);
+	void CalculateAmbiguousNodes();
+	void CalculateComponents();
+	void CalculateNodeStartRanks();
+	void PrintStats() const;
+	FlatArray<size_t> nodeStart;
+	NodeLookup nodeLookup;
+	FlatArray<int> nodeIDs;
+	AdjacencyList inNeighbors;
+	AdjacencyList outNeighbors;
+	FlatArray<uint8_t> reverse;
+	//two bits per base, 32 bases per word, plus one word of padding so NodeSequenceCodes can read past the end
+	FlatArray<uint64_t> nodeSequences;
+	//bases other than ACGT (N and the IUPAC codes) by position, they have code 0 in nodeSequences
+	FlatArray<size_t> ambiguousPositions;
+	FlatArray<uint8_t> ambiguousBases;
+	//1 for the nodes with ambiguous bases, empty if the graph has none
+	FlatArray<uint8_t> ambiguousNodes;
+	//strongly connected component of each node, numbered in topological order:
+	//an edge goes from a node to a node with the same or a higher component number
+	FlatArray<size_t> componentNumber;
+	//rank index of the node starts for IndexToNode, in blocks of ten words per 512bp:
+	//number of node starts before the block, the starts in the block before each of its words (9 bits per word, words 1-7),
+	//then eight words with a bit set at each node start
+	FlatArray<uint64_t> nodeStartRanks;
+	size_t sequenceLength;
 	size_t dummyNodeStart;
 	size_t dummyNodeEnd;
 	bool finalized;
+	std::shared_ptr<const char> mappedIndex;
+
+	//only used while the graph is built, Finalize moves them to the arrays above
+	std::unordered_map<int, size_t> buildNodeLookup;
+	std::vector<size_t> buildNodeStart;
+	std::vector<int> buildNodeIDs;
+	std::vector<std::vector<size_t>> buildInNeighbors;
+	std::vector<std::vector<size_t>> buildOutNeighbors;
+	std::vector<uint8_t> buildReverse;
+	std::vector<uint64_t> buildSequences;
+	std::vector<size_t> buildAmbiguousPositions;
+	std::vector<uint8_t> buildAmbiguousBases;
 
 	template <typename LengthType, typename ScoreType, typename Word>
 	friend class GraphAligner;
+	template <typename LengthType, typename ScoreType, int Lanes>
+	friend class GraphAlignerBatch;
+	friend class SeedIndex;
+	friend class SeedChainer;
 };
 
 
@@ -134,6 +134,25 @@ AlignmentGraph DirectedGraph::StreamVGGraphFromFile(std::string filename)
 	return result;
 }
 
+AlignmentGraph DirectedGraph::BuildFromVG(const vg::Graph& graph)
+{
+	AlignmentGraph result;
+	for (int i = 0; i < graph.node_size(); i++)
+	{
+		auto nodes = ConvertVGNodeToNodes(graph.node(i));
+		result.AddNode(nodes.first.nodeId, nodes.first.sequence, !nodes.first.rightEnd);
+		result.AddNode(nodes.second.nodeId, nodes.second.sequence, !nodes.second.rightEnd);
+	}
+	for (int i = 0; i < graph.edge_size(); i++)
+	{
+		auto edges = ConvertVGEdgeToEdges(graph.edge(i));
+		result.AddEdgeNodeId(edges.first.fromId, edges.first.toId);
+		result.AddEdgeNodeId(edges.second.fromId, edges.second.toId);
+	}
+	result.Finalize(64);
+	return result;
+}
+
 AlignmentGraph DirectedGraph::StreamGFAGraphFromFile(std::string filename)
 {
 	AlignmentGraph result;
@@ -28,6 +28,7 @@ public:
 	static std::pair<Node, Node> ConvertGFANodeToNodes(const std::string& line, int edgeOverlap);
 	static std::pair<Edge, Edge> ConvertGFAEdgeToEdges(const std::string& line);
 	static AlignmentGraph StreamVGGraphFromFile(std::string filename);
+	static AlignmentGraph BuildFromVG(const vg::Graph& graph);
 	static AlignmentGraph StreamGFAGraphFromFile(std::string filename);
 private:
 };
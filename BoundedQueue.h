@@ -0,0 +1,65 @@
+#ifndef BoundedQueue_h
+#define BoundedQueue_h
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "ThreadReadAssertion.h"
+
+//multi-producer multi-consumer queue with a maximum size
+//push blocks while the queue is full and pop blocks while it is empty
+//after close(), pop drains the remaining items and then returns false
+template <typename T>
+class BoundedQueue
+{
+public:
+	BoundedQueue(size_t maxSize) :
+	maxSize(maxSize),
+	closed(false)
+	{
+		assert(maxSize > 0);
+	}
+	void push(T item)
+	{
+		std::unique_lock<std::mutex> lock {mutex};
+		notFull.wait(lock, [this]() { return items.size() < maxSize || closed; });
+		assert(!closed);
+		items.push_back(std::move(item));
+		lock.unlock();
+		notEmpty.notify_one();
+	}
+	bool pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock {mutex};
+		notEmpty.wait(lock, [this]() { return items.size() > 0 || closed; });
+		if (items.size() == 0) return false;
+		item = std::move(items.front());
+		items.pop_front();
+		lock.unlock();
+		notFull.notify_one();
+		return true;
+	}
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock {mutex};
+			closed = true;
+		}
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> lock {mutex};
+		return items.size();
+	}
+private:
+	size_t maxSize;
+	bool closed;
+	std::deque<T> items;
+	mutable std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
+
+#endif
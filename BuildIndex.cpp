@@ -0,0 +1,49 @@
+#include <iostream>
+#include <string>
+#include "vg.pb.h"
+#include "BigraphToDigraph.h"
+#include "AlignmentGraph.h"
+#include "SeedIndex.h"
+
+//converts a .vg or .gfa graph to a binary index which the aligner can load with mmap
+//optionally also writes a seed index with the given k-mer size and sampling rate
+int main(int argc, char** argv)
+{
+	if (argc != 3 && argc != 6)
+	{
+		std::cerr << "usage: BuildIndex graph.(vg|gfa) index.gai [seeds.gsi kmersize samplingrate]" << std::endl;
+		std::exit(0);
+	}
+	std::string graphFile { argv[1] };
+	std::string indexFile { argv[2] };
+	AlignmentGraph graph;
+	if (graphFile.substr(graphFile.size()-3) == ".vg")
+	{
+		graph = DirectedGraph::StreamVGGraphFromFile(graphFile);
+	}
+	else if (graphFile.substr(graphFile.size() - 4) == ".gfa")
+	{
+		graph = DirectedGraph::StreamGFAGraphFromFile(graphFile);
+	}
+	else
+	{
+		std::cerr << "Unknown graph type (" << graphFile << ")" << std::endl;
+		std::exit(0);
+	}
+	graph.SaveIndex(indexFile);
+	std::cerr << "wrote index to " << indexFile << std::endl;
+	if (argc == 6)
+	{
+		std::string seedIndexFile { argv[3] };
+		int kmerSize = std::stoi(argv[4]);
+		int samplingRate = std::stoi(argv[5]);
+		if (kmerSize < 1 || kmerSize > 31 || samplingRate < 1)
+		{
+			std::cerr << "k-mer size must be between 1 and 31 and sampling rate >= 1" << std::endl;
+			std::exit(0);
+		}
+		SeedIndex seedIndex { graph, (size_t)kmerSize, (size_t)samplingRate };
+		seedIndex.Save(seedIndexFile);
+		std::cerr << "wrote " << seedIndex.NumKmers() << " k-mers to " << seedIndexFile << std::endl;
+	}
+}
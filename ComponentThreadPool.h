@@ -0,0 +1,103 @@
+#ifndef ComponentThreadPool_h
+#define ComponentThreadPool_h
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadReadAssertion.h"
+
+//helper threads shared by all alignment threads for splitting one slice's band over several cores
+//a thread which submits work doesn't sleep while it waits, it runs queued tasks (its own or other reads') in helpUntil
+//so a read never waits behind a pool that is busy with other reads
+class ComponentThreadPool
+{
+public:
+	ComponentThreadPool(size_t numThreads) :
+	stopped(false)
+	{
+		for (size_t i = 0; i < numThreads; i++)
+		{
+			threads.emplace_back([this]() { workerLoop(); });
+		}
+	}
+	~ComponentThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock {mutex};
+			stopped = true;
+		}
+		changed.notify_all();
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+	ComponentThreadPool(const ComponentThreadPool& other) = delete;
+	ComponentThreadPool& operator=(const ComponentThreadPool& other) = delete;
+	size_t NumThreads() const
+	{
+		return threads.size();
+	}
+	//tasks must not throw
+	void submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock {mutex};
+			tasks.push_back(std::move(task));
+		}
+		//not notify_one, the woken thread might be a helpUntil which is already done
+		changed.notify_all();
+	}
+	//call after making done() true from a task so a waiting helpUntil notices it
+	void notifyDone()
+	{
+		{
+			std::lock_guard<std::mutex> lock {mutex};
+		}
+		changed.notify_all();
+	}
+	template <typename F>
+	void helpUntil(F done)
+	{
+		std::unique_lock<std::mutex> lock {mutex};
+		while (true)
+		{
+			if (done()) return;
+			if (tasks.size() > 0)
+			{
+				auto task = std::move(tasks.front());
+				tasks.pop_front();
+				lock.unlock();
+				task();
+				lock.lock();
+				continue;
+			}
+			changed.wait(lock);
+		}
+	}
+private:
+	void workerLoop()
+	{
+		std::unique_lock<std::mutex> lock {mutex};
+		while (true)
+		{
+			changed.wait(lock, [this]() { return tasks.size() > 0 || stopped; });
+			if (tasks.size() == 0) return;
+			auto task = std::move(tasks.front());
+			tasks.pop_front();
+			lock.unlock();
+			task();
+			lock.lock();
+		}
+	}
+	bool stopped;
+	std::deque<std::function<void()>> tasks;
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable changed;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef EpochVector_h
+#define EpochVector_h
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "ThreadReadAssertion.h"
+
+//array where each item is stamped with the epoch it was written in.
+//items from earlier epochs read as the default value, so clear() is O(1) instead of O(size)
+template <typename T>
+class EpochVector
+{
+public:
+	EpochVector(size_t size, const T& defaultValue) :
+	items(size, std::make_pair((size_t)0, defaultValue)),
+	defaultValue(defaultValue),
+	epoch(0)
+	{
+	}
+	const T& operator[](size_t index) const
+	{
+		assert(index < items.size());
+		if (items[index].first != epoch) return defaultValue;
+		return items[index].second;
+	}
+	void set(size_t index, const T& value)
+	{
+		assert(index < items.size());
+		items[index] = std::make_pair(epoch, value);
+	}
+	size_t size() const
+	{
+		return items.size();
+	}
+	void clear()
+	{
+		epoch++;
+	}
+private:
+	std::vector<std::pair<size_t, T>> items;
+	T defaultValue;
+	size_t epoch;
+};
+
+//bitvector with an epoch per 64 bits, words from earlier epochs read as all false
+class EpochBitVector
+{
+public:
+	EpochBitVector(size_t size) :
+	bits((size + 63) / 64, 0),
+	epochs((size + 63) / 64, 0),
+	count(size),
+	epoch(0)
+	{
+	}
+	bool operator[](size_t index) const
+	{
+		assert(index < count);
+		if (epochs[index / 64] != epoch) return false;
+		return (bits[index / 64] >> (index % 64)) & 1;
+	}
+	void set(size_t index, bool value)
+	{
+		assert(index < count);
+		size_t word = index / 64;
+		if (epochs[word] != epoch)
+		{
+			epochs[word] = epoch;
+			bits[word] = 0;
+		}
+		if (value)
+		{
+			bits[word] |= (uint64_t)1 << (index % 64);
+		}
+		else
+		{
+			bits[word] &= ~((uint64_t)1 << (index % 64));
+		}
+	}
+	size_t size() const
+	{
+		return count;
+	}
+	void clear()
+	{
+		epoch++;
+	}
+private:
+	std::vector<uint64_t> bits;
+	std::vector<size_t> epochs;
+	size_t count;
+	size_t epoch;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef FlatArray_h
+#define FlatArray_h
+
+#include <vector>
+#include "ThreadReadAssertion.h"
+
+//read-only array which either owns its contents or points to memory owned by someone else, eg. a memory mapped file
+//copies of an owning array own a copy of the contents, copies of a non-owning array point to the same memory
+template <typename T>
+class FlatArray
+{
+public:
+	FlatArray() :
+	owned(),
+	isOwned(true),
+	ptr(nullptr),
+	count(0)
+	{
+	}
+	FlatArray(const FlatArray& other) :
+	owned(other.owned),
+	isOwned(other.isOwned),
+	ptr(other.isOwned ? owned.data() : other.ptr),
+	count(other.count)
+	{
+	}
+	FlatArray(FlatArray&& other) :
+	owned(std::move(other.owned)),
+	isOwned(other.isOwned),
+	ptr(other.isOwned ? owned.data() : other.ptr),
+	count(other.count)
+	{
+		other.ptr = nullptr;
+		other.count = 0;
+	}
+	FlatArray& operator=(const FlatArray& other)
+	{
+		owned = other.owned;
+		isOwned = other.isOwned;
+		ptr = isOwned ? owned.data() : other.ptr;
+		count = other.count;
+		return *this;
+	}
+	FlatArray& operator=(FlatArray&& other)
+	{
+		owned = std::move(other.owned);
+		isOwned = other.isOwned;
+		ptr = isOwned ? owned.data() : other.ptr;
+		count = other.count;
+		other.ptr = nullptr;
+		other.count = 0;
+		return *this;
+	}
+	void assign(std::vector<T>&& data)
+	{
+		owned = std::move(data);
+		owned.shrink_to_fit();
+		isOwned = true;
+		ptr = owned.data();
+		count = owned.size();
+	}
+	void map(const T* data, size_t size)
+	{
+		owned.clear();
+		owned.shrink_to_fit();
+		isOwned = false;
+		ptr = data;
+		count = size;
+	}
+	const T& operator[](size_t index) const
+	{
+		assert(index < count);
+		return ptr[index];
+	}
+	size_t size() const
+	{
+		return count;
+	}
+	const T* data() const
+	{
+		return ptr;
+	}
+	const T* begin() const
+	{
+		return ptr;
+	}
+	const T* end() const
+	{
+		return ptr + count;
+	}
+private:
+	std::vector<T> owned;
+	bool isOwned;
+	const T* ptr;
+	size_t count;
+};
+
+#endif
@@ -3,6 +3,10 @@
 
 #include <chrono>
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include <cmath>
@@ -20,6 +24,7 @@
 #include "UniqueQueue.h"
 #include "WordSlice.h"
 #include "GraphAlignerCommon.h"
+#include "GraphAlignerWorkspace.h"
 
 void printtime(const char* msg)
 {
@@ -55,24 +60,40 @@ size_t getset(const std::unordered_set<size_t>& set, size_t pos)
 thread_local int debugLastRowMinScore;
 #endif
 
+class GraphAlignerKernelBenchmark;
+template <typename LengthType, typename ScoreType, int Lanes>
+class GraphAlignerBatch;
+
 template <typename LengthType, typename ScoreType, typename Word>
 class GraphAligner
 {
+	//KernelBench.cpp times the private DP kernels directly
+	friend class GraphAlignerKernelBenchmark;
+	//uses characterMatch
+	template <typename, typename, int>
+	friend class GraphAlignerBatch;
 private:
 	using WordSlice = typename WordContainer<LengthType, ScoreType, Word>::Slice;
 	mutable BufferedWriter logger;
 	typedef GraphAlignerParams<LengthType, ScoreType, Word> Params;
+	typedef GraphAlignerWorkspace<LengthType> Workspace;
 	const Params& params;
+	//the caller acquires and releases the workspace around each alignment
+	Workspace& workspace;
+	mutable AlignmentResult::AlignmentStats stats;
 	typedef std::pair<LengthType, LengthType> MatrixPosition;
 	class EqVector
 	{
 	public:
 		EqVector(Word BA, Word BT, Word BC, Word BG) :
-		BA(BA),
-		BT(BT),
-		BC(BC),
-		BG(BG)
+		Eqs { BA, BT, BC, BG }
+		{
+		}
+		//by the graph's 2-bit code, A=0, T=1, C=2, G=3
+		Word getEqByCode(uint64_t code) const
 		{
+			assert(code < 4);
+			return Eqs[code];
 		}
 		Word getEq(char c) const
 		{
@@ -80,27 +101,35 @@ private:
 			{
 				case 'A':
 				case 'a':
-					return BA;
+					return Eqs[0];
 				case 'T':
 				case 't':
-					return BT;
+					return Eqs[1];
 				case 'C':
 				case 'c':
-					return BC;
+					return Eqs[2];
 				case 'G':
 				case 'g':
-					return BG;
+					return Eqs[3];
 				case '-':
-				default:
 					assert(false);
+				default:
+				{
+					//ambiguous graph base, matches where any of its bases match
+					Word result = WordConfiguration<Word>::AllZeros;
+					int mask = baseMask(c);
+					assert(mask != 0);
+					for (int code = 0; code < 4; code++)
+					{
+						if (mask & (1 << code)) result |= Eqs[code];
+					}
+					return result;
+				}
 			}
 			assert(false);
 			return 0;
 		}
-		Word BA;
-		Word BT;
-		Word BC;
-		Word BG;
+		Word Eqs[4];
 	};
 	class DPSlice
 	{
@@ -115,7 +144,7 @@ private:
 		cellsProcessed(0),
 		numCells(0)
 		{}
-		DPSlice(std::vector<typename NodeSlice<WordSlice>::MapItem>* vectorMap) :
+		DPSlice(EpochVector<typename NodeSlice<WordSlice>::MapItem>* vectorMap) :
 		minScore(std::numeric_limits<ScoreType>::min()),
 		minScoreIndex(),
 		scores(vectorMap),
@@ -128,7 +157,7 @@ private:
 		ScoreType minScore;
 		std::vector<LengthType> minScoreIndex;
 		NodeSlice<WordSlice> scores;
-		std::vector<size_t> nodes;
+		std::vector<LengthType> nodes;
 		AlignmentCorrectnessEstimationState correctness;
 		LengthType j;
 		size_t cellsProcessed;
@@ -163,207 +192,324 @@ private:
 			result.numCells = numCells;
 			return result;
 		}
+		DPSlice getCompressedScores() const
+		{
+			DPSlice result;
+			result.scores = scores.getCompressedScores();
+			result.minScore = minScore;
+			result.minScoreIndex = minScoreIndex;
+			result.nodes = nodes;
+			result.correctness = correctness;
+			result.j = j;
+			result.cellsProcessed = cellsProcessed;
+			result.numCells = numCells;
+			return result;
+		}
+		DPSlice getCompressedSqrtEndScores() const
+		{
+			DPSlice result;
+			result.scores = scores.getCompressedSqrtEndScores();
+			result.minScore = minScore;
+			result.minScoreIndex = minScoreIndex;
+			result.nodes = nodes;
+			result.correctness = correctness;
+			result.j = j;
+			result.cellsProcessed = cellsProcessed;
+			result.numCells = numCells;
+			return result;
+		}
+		DPSlice getDecompressedScores() const
+		{
+			DPSlice result;
+			result.scores = scores.getDecompressedScores();
+			result.minScore = minScore;
+			result.minScoreIndex = minScoreIndex;
+			result.nodes = nodes;
+			result.correctness = correctness;
+			result.j = j;
+			result.cellsProcessed = cellsProcessed;
+			result.numCells = numCells;
+			return result;
+		}
+		//actual bytes of the slice as it is stored, unlike EstimatedMemoryUsage which is the size of its sqrt end scores
+		size_t StoredMemoryUsage() const
+		{
+			return scores.MemoryUsage() + (minScoreIndex.capacity() + nodes.capacity()) * sizeof(LengthType);
+		}
 	};
+	//the backtrace through slices which are too wide to store or to recalculate, picked during the forward pass
+	//only the cells on a backtrace from the end of the last slice are stored
 	class BacktraceOverride
 	{
 	public:
 		class BacktraceItem
 		{
 		public:
-			BacktraceItem(bool previousInSameRow, size_t previousIndex, MatrixPosition pos) :
-			end(false),
-			previousInSameRow(previousInSameRow),
-			previousIndex(previousIndex),
-			pos(pos)
+			BacktraceItem(LengthType column, bool end) :
+			column(column),
+			previousIndex(0),
+			end(end),
+			previousInSameRow(false)
 			{}
+			LengthType column;
+			//index of the predecessor in its row, or its column if it is in the row before the first slice
+			LengthType previousIndex;
 			bool end;
 			bool previousInSameRow;
-			size_t previousIndex;
-			MatrixPosition pos;
 		};
-		BacktraceOverride()
+		BacktraceOverride() :
+		startj(0),
+		endj(0),
+		peakMemory(0)
 		{
 		}
-		BacktraceOverride(const Params& params, const std::string& sequence, const DPSlice& previous, const std::vector<DPSlice>& slices)
+		//the slices can be compressed, only two of them are decompressed at a time
+		BacktraceOverride(const Params& params, const std::string& sequence, const DPSlice& previous, const std::vector<DPSlice>& slices) :
+		peakMemory(0)
 		{
 			assert(slices.size() > 0);
 			startj = slices[0].j;
 			endj = slices.back().j;
 			assert(endj == startj + (slices.size()-1) * WordConfiguration<Word>::WordSize);
-			items.resize(WordConfiguration<Word>::WordSize * slices.size());
 			makeTrace(params, sequence, previous, slices);
 		};
 		//returns the trace backwards, aka result[0] is at the bottom of the slice and result.back() at the top
 		std::vector<MatrixPosition> GetBacktrace(MatrixPosition start) const
 		{
-			assert(items.size() > 0);
-			assert(items.size() % WordConfiguration<Word>::WordSize == 0);
-			assert(items.back().size() > 0);
-			assert(items.back()[0].pos.second == start.second);
-			size_t currentIndex = -1;
-			size_t currentRow = items.size()-1;
+			assert(numRows() > 0);
+			assert(numRows() % WordConfiguration<Word>::WordSize == 0);
+			assert(start.second == startj + numRows() - 1);
+			size_t currentRow = numRows()-1;
+			size_t currentIndex = indexInRow(rowBegin(currentRow), rowEnd(currentRow), start.first);
 			std::vector<MatrixPosition> result;
-			for (size_t i = 0; i < items.back().size(); i++)
-			{
-				if (items.back()[i].pos == start)
-				{
-					currentIndex = i;
-					break;
-				}
-			}
-			assert(currentIndex != -1);
 			while (true)
 			{
-				auto current = items[currentRow][currentIndex];
+				const auto& current = items[rowBegin(currentRow) + currentIndex];
 				assert(!current.end);
-				result.push_back(current.pos);
-				size_t nextIndex = current.previousIndex;
-				size_t nextRow = current.previousInSameRow ? currentRow : currentRow - 1;
-				if (nextRow == -1)
+				result.emplace_back(current.column, startj + currentRow);
+				if (!current.previousInSameRow)
 				{
-					result.emplace_back(nextIndex, current.pos.second-1);
-					break;
+					if (currentRow == 0)
+					{
+						result.emplace_back(current.previousIndex, startj - 1);
+						break;
+					}
+					currentRow--;
 				}
-				currentIndex = nextIndex;
-				currentRow = nextRow;
+				currentIndex = current.previousIndex;
 			}
 			return result;
 		}
+		size_t MemoryUsage() const
+		{
+			return items.capacity() * sizeof(BacktraceItem) + rowStart.capacity() * sizeof(size_t);
+		}
+		//the most memory used while building, including the two decompressed slices but not the input slices
+		size_t PeakMemoryUsage() const
+		{
+			return peakMemory;
+		}
 		LengthType startj;
 		LengthType endj;
 	private:
-		void addReachableRec(const Params& params, MatrixPosition pos, size_t row, const std::string& sequence, const DPSlice& previous, const std::vector<DPSlice>& slices, std::vector<std::unordered_map<LengthType, size_t>>& indices)
+		size_t numRows() const
 		{
-			assert(row < indices.size());
-			if (indices[row].count(pos.first) == 1) return;
-			auto size = indices[row].size();
-			indices[row][pos.first] = size;
-			if (row > 0 && row % WordConfiguration<Word>::WordSize == WordConfiguration<Word>::WordSize - 1)
-			{
-				size_t sliceIndex = row / WordConfiguration<Word>::WordSize;
-				assert(sliceIndex < slices.size());
-				auto nodeIndex = params.graph.IndexToNode(pos.first);
-				assert(slices[sliceIndex].scores.hasNode(nodeIndex));
-				auto nodeStart = params.graph.NodeStart(nodeIndex);
-				auto offset = pos.first - nodeStart;
-				if (!slices[sliceIndex].scores.node(nodeIndex)[offset].scoreEndExists) return;
-			}
-			assert(row == pos.second - slices[0].j);
-			size_t sliceIndex = row / WordConfiguration<Word>::WordSize;
-			MatrixPosition predecessor;
-			if (sliceIndex > 0)
-			{
-				predecessor = pickBacktracePredecessor(params, sequence, slices[sliceIndex], pos, slices[sliceIndex-1]);
-			}
-			else
-			{
-				predecessor = pickBacktracePredecessor(params, sequence, slices[0], pos, previous);
-			}
-			assert(predecessor.second == pos.second || predecessor.second == pos.second-1);
-			if (predecessor.second >= slices[0].j && predecessor.second != -1)
-			{
-				addReachableRec(params, predecessor, predecessor.second - slices[0].j, sequence, previous, slices, indices);
-			}
+			return rowStart.size() - 1;
+		}
+		//the rows are stored from the last one to the first one
+		size_t rowBegin(size_t row) const
+		{
+			return rowStart[numRows() - 1 - row];
 		}
+		size_t rowEnd(size_t row) const
+		{
+			return rowStart[numRows() - row];
+		}
+		//the items of a row are sorted by column
+		LengthType indexInRow(size_t begin, size_t end, LengthType column) const
+		{
+			auto found = std::lower_bound(items.begin() + begin, items.begin() + end, column, [](const BacktraceItem& item, LengthType column) { return item.column < column; });
+			assert(found != items.begin() + end);
+			assert(found->column == column);
+			return found - (items.begin() + begin);
+		}
+		//one bit per cell of the slice, column-major
+		static size_t reachedBitmapWords(const DPSlice& slice)
+		{
+			return (slice.scores.totalColumns() * WordConfiguration<Word>::WordSize + 63) / 64;
+		}
+		//returns false if the cell was already marked
+		static bool markReached(const Params& params, const DPSlice& slice, std::vector<uint64_t>& reached, size_t rowInSlice, LengthType column)
+		{
+			auto nodeIndex = params.graph.IndexToNode(column);
+			assert(slice.scores.hasNode(nodeIndex));
+			size_t bit = (slice.scores.firstColumn(nodeIndex) + column - params.graph.NodeStart(nodeIndex)) * WordConfiguration<Word>::WordSize + rowInSlice;
+			assert(bit / 64 < reached.size());
+			uint64_t mask = ((uint64_t)1) << (bit % 64);
+			if (reached[bit / 64] & mask) return false;
+			reached[bit / 64] |= mask;
+			return true;
+		}
+		//sweeps the rows from the last one up. the predecessor of a cell is in the same row or the row before,
+		//so a row's cells are all known once the row after it and its own predecessors in the row are done
 		void makeTrace(const Params& params, const std::string& sequence, const DPSlice& previous, const std::vector<DPSlice>& slices)
 		{
 			assert(slices.size() > 0);
-			assert(items.size() == WordConfiguration<Word>::WordSize * slices.size());
-			std::vector<std::unordered_map<LengthType, size_t>> indexOfPos;
-			indexOfPos.resize(items.size());
-			size_t endrow = items.size()-1;
-#ifdef SLICEVERBOSE
-			size_t numEndCells = 0;
-#endif
-			for (const auto& pair : slices.back().scores)
+			const size_t WordSize = WordConfiguration<Word>::WordSize;
+			size_t rows = slices.size() * WordSize;
+			rowStart.reserve(rows + 1);
+			rowStart.push_back(0);
+			size_t sliceIndex = slices.size()-1;
+			DPSlice current = slices[sliceIndex].getDecompressedScores();
+			DPSlice before;
+			if (sliceIndex > 0) before = slices[sliceIndex-1].getDecompressedScores();
+			std::vector<uint64_t> currentReached;
+			std::vector<uint64_t> beforeReached;
+			currentReached.resize(reachedBitmapWords(current), 0);
+			if (sliceIndex > 0) beforeReached.resize(reachedBitmapWords(before), 0);
+			//cells of the current row, found either from the row after it or from their neighbors in the row
+			std::vector<LengthType> rowCells;
+			std::vector<LengthType> previousRowCells;
+			//const so the frozen scores are read with the const accessors
+			const DPSlice& last = current;
+			for (const auto& pair : last.scores)
 			{
 				LengthType nodeStart = params.graph.NodeStart(pair.first);
-				LengthType endj = slices.back().j + WordConfiguration<Word>::WordSize-1;
 				for (size_t i = 0; i < pair.second.size(); i++)
 				{
 					if (pair.second[i].scoreEndExists)
 					{
-#ifdef SLICEVERBOSE
-						numEndCells++;
-#endif
-						addReachableRec(params, MatrixPosition { nodeStart+i, endj }, endrow, sequence, previous, slices, indexOfPos);
+						markReached(params, last, currentReached, WordSize-1, nodeStart+i);
+						rowCells.push_back(nodeStart+i);
 					}
 				}
 			}
 #ifdef SLICEVERBOSE
-			std::cerr << " endcells " << numEndCells;
+			std::cerr << " endcells " << rowCells.size();
 #endif
-
-			for (size_t row = items.size()-1; row < items.size(); row--)
+			size_t laterRowBegin = 0;
+			for (size_t row = rows-1; row < rows; row--)
 			{
-				items[row].resize(indexOfPos[row].size(), BacktraceItem {false, 0, MatrixPosition {0, 0}});
-				for (auto pair : indexOfPos[row])
+				if (row / WordSize != sliceIndex)
 				{
-					auto w = pair.first;
-					auto index = pair.second;
-					MatrixPosition pos { w, slices[0].j + row };
-					items[row][index].pos = pos;
-					MatrixPosition predecessor;
-					size_t sliceIndex = row / WordConfiguration<Word>::WordSize;
-					if (row % WordConfiguration<Word>::WordSize == WordConfiguration<Word>::WordSize - 1)
+					assert(row / WordSize == sliceIndex-1);
+					sliceIndex--;
+					current = std::move(before);
+					std::swap(currentReached, beforeReached);
+					before = DPSlice {};
+					beforeReached.clear();
+					if (sliceIndex > 0)
+					{
+						before = slices[sliceIndex-1].getDecompressedScores();
+						beforeReached.resize(reachedBitmapWords(before), 0);
+					}
+				}
+				size_t rowInSlice = row % WordSize;
+				const DPSlice& currentSlice = current;
+				const DPSlice& previousSlice = sliceIndex > 0 ? before : previous;
+				size_t begin = items.size();
+				//rowCells grows while it's iterated
+				for (size_t i = 0; i < rowCells.size(); i++)
+				{
+					LengthType w = rowCells[i];
+					MatrixPosition pos { w, startj + row };
+					if (rowInSlice == WordSize - 1)
 					{
 						auto nodeIndex = params.graph.IndexToNode(w);
-						auto offset = w - params.graph.NodeStart(nodeIndex);
-						assert(slices[sliceIndex].scores.hasNode(nodeIndex));
-						if (!slices[sliceIndex].scores.node(nodeIndex)[offset].scoreEndExists)
+						assert(currentSlice.scores.hasNode(nodeIndex));
+						if (!currentSlice.scores.node(nodeIndex)[w - params.graph.NodeStart(nodeIndex)].scoreEndExists)
 						{
-							items[row][index].end = true;
+							items.emplace_back(w, true);
 							continue;
 						}
 					}
-					if (sliceIndex > 0)
-					{
-						predecessor = pickBacktracePredecessor(params, sequence, slices[sliceIndex], pos, slices[sliceIndex-1]);
-					}
-					else
-					{
-						predecessor = pickBacktracePredecessor(params, sequence, slices[0], pos, previous);
-					}
+					MatrixPosition predecessor = pickBacktracePredecessor(params, sequence, currentSlice, pos, previousSlice);
+					assert(predecessor.second == pos.second || predecessor.second == pos.second-1);
+					items.emplace_back(w, false);
+					//the column for now, replaced with the index once the predecessor's row is sorted
+					items.back().previousIndex = predecessor.first;
 					if (predecessor.second == pos.second)
 					{
-						items[row][index].previousInSameRow = true;
-						items[row][index].previousIndex = indexOfPos[row].at(predecessor.first);
+						items.back().previousInSameRow = true;
+						if (markReached(params, currentSlice, currentReached, rowInSlice, predecessor.first)) rowCells.push_back(predecessor.first);
 					}
-					else
+					else if (row > 0)
 					{
-						items[row][index].previousInSameRow = false;
-						if (row != 0)
+						bool added;
+						if (rowInSlice == 0)
 						{
-							items[row][index].previousIndex = indexOfPos[row-1].at(predecessor.first);
+							added = markReached(params, previousSlice, beforeReached, WordSize-1, predecessor.first);
 						}
 						else
 						{
-							items[row][index].previousIndex = predecessor.first;
+							added = markReached(params, currentSlice, currentReached, rowInSlice-1, predecessor.first);
 						}
+						if (added) previousRowCells.push_back(predecessor.first);
 					}
 				}
-#ifndef NDEBUG
-				for (size_t i = 0; i < items[row].size(); i++)
+				assert(items.size() - begin == rowCells.size());
+				std::sort(items.begin() + begin, items.end(), [](const BacktraceItem& left, const BacktraceItem& right) { return left.column < right.column; });
+				rowStart.push_back(items.size());
+				for (size_t i = begin; i < items.size(); i++)
 				{
-					assert(items[row][i].end || items[row][i].pos.first != 0);
+					if (!items[i].end && items[i].previousInSameRow) items[i].previousIndex = indexInRow(begin, items.size(), items[i].previousIndex);
 				}
-#endif
+				if (row < rows-1)
+				{
+					for (size_t i = laterRowBegin; i < begin; i++)
+					{
+						if (!items[i].end && !items[i].previousInSameRow) items[i].previousIndex = indexInRow(begin, items.size(), items[i].previousIndex);
+					}
+				}
+				size_t scratchMemory = current.StoredMemoryUsage() + before.StoredMemoryUsage() + (currentReached.capacity() + beforeReached.capacity()) * sizeof(uint64_t) + (rowCells.capacity() + previousRowCells.capacity()) * sizeof(LengthType);
+				peakMemory = std::max(peakMemory, MemoryUsage() + scratchMemory);
+				laterRowBegin = begin;
+				std::swap(rowCells, previousRowCells);
+				previousRowCells.clear();
 			}
+			assert(rowCells.size() == 0);
+			assert(numRows() == rows);
 		}
-		std::vector<std::vector<BacktraceItem>> items;
+		//flattened rows, see rowBegin
+		std::vector<BacktraceItem> items;
+		std::vector<size_t> rowStart;
+		size_t peakMemory;
 	};
 	class DPTable
 	{
 	public:
 		DPTable() :
 		slices(),
-		samplingFrequency(0)
+		samplingFrequency(0),
+		cellsProcessed(0),
+		fullSlices(),
+		memoryPerSlice(),
+		fullSlicesMemory(0),
+		memoryBudget(0),
+		minScorePerSlice()
 		{}
+		//the backtrace doesn't recompute anything if every slice's full scores were kept
+		bool HasAllSlices() const
+		{
+			return fullSlices.size() == bandwidthPerSlice.size();
+		}
 		std::vector<DPSlice> slices;
 		size_t samplingFrequency;
+		size_t cellsProcessed;
 		std::vector<LengthType> bandwidthPerSlice;
 		std::vector<AlignmentCorrectnessEstimationState> correctness;
 		std::vector<BacktraceOverride> backtraceOverrides;
+		//full scores of every slice as long as they fit in the memory budget, empty slices inside backtrace overrides
+		std::vector<DPSlice> fullSlices;
+		//EstimatedMemoryUsage of each slice
+		std::vector<size_t> memoryPerSlice;
+		//StoredMemoryUsage of fullSlices
+		size_t fullSlicesMemory;
+		//what was left of the params' checkpoint memory budget (-C) when the table was calculated
+		size_t memoryBudget;
+		//minimum score and its cell in each slice's last row, or in the sequence's last row before the padding.
+		//the score-only alignment's result
+		std::vector<std::pair<ScoreType, LengthType>> minScorePerSlice;
 	};
 	class TwoDirectionalSplitAlignment
 	{
@@ -378,16 +524,18 @@ private:
 	};
 public:
 
-	GraphAligner(const Params& params) :
+	GraphAligner(const Params& params, Workspace& workspace) :
 	logger(std::cerr),
-	params(params)
+	params(params),
+	workspace(workspace),
+	stats()
 	{
+		static_assert(std::is_same<typename Workspace::MapItem, typename NodeSlice<WordSlice>::MapItem>::value, "workspace map type must match NodeSlice");
 	}
 	
 	AlignmentResult AlignOneWay(const std::string& seq_id, const std::string& sequence, LengthType dynamicRowStart) const
 	{
-		std::vector<typename NodeSlice<WordSlice>::MapItem> nodesliceMap;
-		nodesliceMap.resize(params.graph.NodeSize(), {0, 0, 0});
+		auto& nodesliceMap = workspace.nodesliceMap;
 		auto timeStart = std::chrono::system_clock::now();
 		assert(params.graph.finalized);
 		auto trace = getBacktraceFullStart(sequence, nodesliceMap);
@@ -396,12 +544,15 @@ public:
 		//failed alignment, don't output
 		if (std::get<0>(trace) == std::numeric_limits<ScoreType>::max()) return emptyAlignment(time, std::get<2>(trace));
 		if (std::get<1>(trace).size() == 0) return emptyAlignment(time, std::get<2>(trace));
+		auto outputStart = std::chrono::system_clock::now();
 		auto result = traceToAlignment(seq_id, sequence, std::get<0>(trace), std::get<1>(trace), std::get<2>(trace));
 		result.alignmentStart = std::get<1>(trace)[0].second;
 		result.alignmentEnd = std::get<1>(trace).back().second;
 		timeEnd = std::chrono::system_clock::now();
+		stats.outputMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - outputStart).count();
 		time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
 		result.elapsedMilliseconds = time;
+		result.stats = stats;
 		return result;
 	}
 
@@ -415,8 +566,8 @@ public:
 		std::vector<std::tuple<size_t, size_t, size_t>> triedAlignmentNodes;
 		std::pair<std::tuple<ScoreType, std::vector<MatrixPosition>>, std::tuple<ScoreType, std::vector<MatrixPosition>>> bestTrace;
 		bool hasAlignment = false;
-		std::vector<typename NodeSlice<WordSlice>::MapItem> nodesliceMap;
-		nodesliceMap.resize(params.graph.NodeSize(), {0, 0, 0});
+		size_t cellsProcessed = 0;
+		auto& nodesliceMap = workspace.nodesliceMap;
 		for (size_t i = 0; i < seedHits.size(); i++)
 		{
 			logger << "seed " << i << "/" << seedHits.size() << " " << std::get<0>(seedHits[i]) << (std::get<2>(seedHits[i]) ? "-" : "+") << "," << std::get<1>(seedHits[i]);
@@ -427,8 +578,16 @@ public:
 				logger << "seed " << i << " already aligned" << BufferedWriter::Flush;
 				continue;
 			}
+			if (hasAlignment && seedCantImprove(bestAlignmentEstimatedCorrectlyAligned, sequence.size(), pos))
+			{
+				logger << "seed " << i << " can't improve the alignment" << BufferedWriter::Flush;
+				stats.seedsSkipped++;
+				continue;
+			}
 			logger << BufferedWriter::Flush;
-			auto alignment = getSplitAlignment(sequence, std::get<0>(seedHits[i]), std::get<2>(seedHits[i]), std::get<1>(seedHits[i]), sequence.size() * 0.4, nodesliceMap);
+			stats.seedsTried++;
+			auto alignment = getSplitAlignment(sequence, std::get<0>(seedHits[i]), std::get<2>(seedHits[i]), std::get<1>(seedHits[i]), sequence.size() * 0.4, true, nodesliceMap);
+			cellsProcessed += alignment.forward.cellsProcessed + alignment.backward.cellsProcessed;
 			auto trace = getPiecewiseTracesFromSplit(alignment, sequence, nodesliceMap);
 			addAlignmentNodes(triedAlignmentNodes, trace, alignment.sequenceSplitIndex);
 			if (!hasAlignment)
@@ -453,13 +612,14 @@ public:
 		//failed alignment, don't output
 		if (!hasAlignment)
 		{
-			return emptyAlignment(time, 0);
+			return emptyAlignment(time, cellsProcessed);
 		}
 		if (std::get<0>(bestTrace.first) == std::numeric_limits<ScoreType>::max() && std::get<0>(bestTrace.second) == std::numeric_limits<ScoreType>::max())
 		{
-			return emptyAlignment(time, 0);
+			return emptyAlignment(time, cellsProcessed);
 		}
 
+		auto outputStart = std::chrono::system_clock::now();
 		auto traceVector = getTraceInfo(sequence, std::get<1>(bestTrace.second), std::get<1>(bestTrace.first));
 
 		auto fwresult = traceToAlignment(seq_id, sequence, std::get<0>(bestTrace.first), std::get<1>(bestTrace.first), 0);
@@ -467,9 +627,10 @@ public:
 		//failed alignment, don't output
 		if (fwresult.alignmentFailed && bwresult.alignmentFailed)
 		{
-			return emptyAlignment(time, 0);
+			return emptyAlignment(time, cellsProcessed);
 		}
 		auto result = mergeAlignments(bwresult, fwresult);
+		result.cellsProcessed = cellsProcessed;
 		result.trace = traceVector;
 		LengthType lastAligned = 0;
 		if (std::get<1>(bestTrace.second).size() > 0)
@@ -485,11 +646,112 @@ public:
 		result.alignmentStart = lastAligned;
 		result.alignmentEnd = result.alignmentStart + bestAlignmentEstimatedCorrectlyAligned;
 		timeEnd = std::chrono::system_clock::now();
+		stats.outputMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - outputStart).count();
 		time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
 		result.elapsedMilliseconds = time;
+		result.stats = stats;
 		return result;
 	}
 
+	//the forward pass of the seeded AlignOneWay without checkpoints or backtrace.
+	//seeds can't be skipped by the nodes of earlier alignments since there's no trace, so every seed is extended
+	AlignmentResult AlignOneWayScoreOnly(const std::string& seq_id, const std::string& sequence, const std::vector<std::tuple<int, size_t, bool>>& seedHits) const
+	{
+		auto timeStart = std::chrono::system_clock::now();
+		assert(params.graph.finalized);
+		assert(seedHits.size() > 0);
+		stats.checkpointPolicy = AlignmentResult::NoCheckpoints;
+		size_t bestAlignmentEstimatedCorrectlyAligned = 0;
+		std::tuple<int, size_t, bool> bestSeed;
+		TwoDirectionalSplitAlignment bestAlignment;
+		bool hasAlignment = false;
+		size_t cellsProcessed = 0;
+		auto& nodesliceMap = workspace.nodesliceMap;
+		for (size_t i = 0; i < seedHits.size(); i++)
+		{
+			logger << "seed " << i << "/" << seedHits.size() << " " << std::get<0>(seedHits[i]) << (std::get<2>(seedHits[i]) ? "-" : "+") << "," << std::get<1>(seedHits[i]);
+			if (hasAlignment && seedCantImprove(bestAlignmentEstimatedCorrectlyAligned, sequence.size(), std::get<1>(seedHits[i])))
+			{
+				logger << "seed " << i << " can't improve the alignment" << BufferedWriter::Flush;
+				stats.seedsSkipped++;
+				continue;
+			}
+			logger << BufferedWriter::Flush;
+			stats.seedsTried++;
+			auto alignment = getSplitAlignment(sequence, std::get<0>(seedHits[i]), std::get<2>(seedHits[i]), std::get<1>(seedHits[i]), sequence.size() * 0.4, false, nodesliceMap);
+			cellsProcessed += alignment.forward.cellsProcessed + alignment.backward.cellsProcessed;
+			if (alignment.forward.minScorePerSlice.size() == 0 && alignment.backward.minScorePerSlice.size() == 0) continue;
+			if (!hasAlignment || alignment.EstimatedCorrectlyAligned() > bestAlignmentEstimatedCorrectlyAligned)
+			{
+				bestAlignmentEstimatedCorrectlyAligned = alignment.EstimatedCorrectlyAligned();
+				bestSeed = seedHits[i];
+				bestAlignment = std::move(alignment);
+				hasAlignment = true;
+			}
+		}
+		auto timeEnd = std::chrono::system_clock::now();
+		size_t time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
+		//failed alignment, don't output
+		if (!hasAlignment)
+		{
+			return emptyAlignment(time, cellsProcessed);
+		}
+		auto outputStart = std::chrono::system_clock::now();
+		ScoreType score = 0;
+		auto seedNode = params.graph.nodeLookup.at(std::get<0>(bestSeed) * 2 + (std::get<2>(bestSeed) ? 1 : 0));
+		LengthType startIndex = params.graph.NodeStart(seedNode);
+		LengthType endIndex = params.graph.NodeStart(seedNode);
+		if (bestAlignment.backward.minScorePerSlice.size() > 0)
+		{
+			score += bestAlignment.backward.minScorePerSlice.back().first;
+			startIndex = params.graph.GetReversePosition(bestAlignment.backward.minScorePerSlice.back().second);
+		}
+		if (bestAlignment.forward.minScorePerSlice.size() > 0)
+		{
+			score += bestAlignment.forward.minScorePerSlice.back().first;
+			endIndex = bestAlignment.forward.minScorePerSlice.back().second;
+		}
+		vg::Alignment alignment;
+		alignment.set_name(seq_id);
+		alignment.set_score(score);
+		AlignmentResult result { alignment, false, cellsProcessed, time };
+		size_t backwardRows = bestAlignment.backward.bandwidthPerSlice.size() * WordConfiguration<Word>::WordSize;
+		result.alignmentStart = bestAlignment.sequenceSplitIndex - std::min(bestAlignment.sequenceSplitIndex, backwardRows);
+		//the estimate counts whole slices so it includes the padding after the read
+		result.alignmentEnd = std::min(result.alignmentStart + bestAlignmentEstimatedCorrectlyAligned, sequence.size());
+		result.alignment.set_query_position(result.alignmentStart);
+		result.startPosition = indexToGraphPosition(startIndex);
+		result.endPosition = indexToGraphPosition(endIndex);
+		timeEnd = std::chrono::system_clock::now();
+		stats.outputMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - outputStart).count();
+		time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
+		result.elapsedMilliseconds = time;
+		result.stats = stats;
+		return result;
+	}
+
+	//EstimatedCorrectlyAligned of a split alignment from this read position which reaches both ends of the read
+	size_t maxEstimatedCorrectlyAligned(size_t sequenceLength, size_t seedPosition) const
+	{
+		size_t result = 0;
+		if (seedPosition > 0) result += (seedPosition + params.graph.DBGOverlap + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize * WordConfiguration<Word>::WordSize;
+		if (seedPosition < sequenceLength - 1) result += (sequenceLength - seedPosition + WordConfiguration<Word>::WordSize - 1) / WordConfiguration<Word>::WordSize * WordConfiguration<Word>::WordSize;
+		return result;
+	}
+
+	//a seed only replaces the best alignment if it aligns more, see the params' seedStopFraction
+	bool seedCantImprove(size_t bestEstimatedCorrectlyAligned, size_t sequenceLength, size_t seedPosition) const
+	{
+		if (params.seedStopFraction == 0) return false;
+		return bestEstimatedCorrectlyAligned >= params.seedStopFraction * maxEstimatedCorrectlyAligned(sequenceLength, seedPosition);
+	}
+
+	AlignmentResult::GraphPosition indexToGraphPosition(LengthType index) const
+	{
+		auto nodeIndex = params.graph.IndexToNode(index);
+		return AlignmentResult::GraphPosition { params.graph.nodeIDs[nodeIndex] / 2, index - params.graph.NodeStart(nodeIndex), (bool)params.graph.reverse[nodeIndex] };
+	}
+
 	static MatrixPosition pickBacktracePredecessor(const Params& params, const std::string& sequence, const DPSlice& slice, const MatrixPosition pos, const DPSlice& previousSlice)
 	{
 		assert(pos.second >= slice.j);
@@ -637,7 +899,9 @@ private:
 	{
 		vg::Alignment result;
 		result.set_score(std::numeric_limits<decltype(result.score())>::max());
-		return AlignmentResult { result, true, cellsProcessed, elapsedMilliseconds };
+		AlignmentResult empty { result, true, cellsProcessed, elapsedMilliseconds };
+		empty.stats = stats;
+		return empty;
 	}
 
 	bool posEqual(const vg::Position& pos1, const vg::Position& pos2) const
@@ -891,7 +1155,7 @@ private:
 	}
 #endif
 
-	std::pair<ScoreType, std::vector<MatrixPosition>> getTraceFromTable(const std::string& sequence, const DPTable& slice, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	std::pair<ScoreType, std::vector<MatrixPosition>> getTraceFromTable(const std::string& sequence, const DPTable& slice, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
 	{
 		assert(slice.bandwidthPerSlice.size() == slice.correctness.size());
 		assert(sequence.size() % WordConfiguration<Word>::WordSize == 0);
@@ -904,6 +1168,7 @@ private:
 			return std::make_pair(std::numeric_limits<ScoreType>::max(), std::vector<MatrixPosition>{});
 		}
 		assert(slice.samplingFrequency > 1);
+		auto backtraceStart = std::chrono::system_clock::now();
 		std::pair<ScoreType, std::vector<MatrixPosition>> result {0, {}};
 		size_t backtraceOverrideIndex = -1;
 		LengthType lastBacktraceOverrideStartJ = -1;
@@ -922,21 +1187,19 @@ private:
 				result.second.emplace_back(slice.slices.back().minScoreIndex.back(), slice.slices.back().j + WordConfiguration<Word>::WordSize - 1);
 				continue;
 			}
-			auto partTable = getSlicesFromTable(sequence, lastBacktraceOverrideStartJ, slice, i, nodesliceMap);
-			assert(partTable.size() > 0);
-			if (i == slice.slices.size() - 1)
-			{
-				result.first = partTable.back().minScore;
-				assert(partTable.back().minScoreIndex.size() > 0);
-				result.second.emplace_back(partTable.back().minScoreIndex.back(), partTable.back().j + WordConfiguration<Word>::WordSize - 1);
-			}
-			auto partTrace = getTraceFromTableInner(sequence, partTable, result.second.back());
-			assert(partTrace.size() > 1);
-			//begin()+1 because the starting position was already inserted earlier
-			result.second.insert(result.second.end(), partTrace.begin()+1, partTrace.end());
-			auto boundaryTrace = getSliceBoundaryTrace(sequence, partTable[0], slice.slices[i], result.second.back().first);
-			result.second.insert(result.second.end(), boundaryTrace.begin(), boundaryTrace.end());
-			assert(boundaryTrace.size() > 0);
+			size_t startSlice = (slice.slices[i].j + WordConfiguration<Word>::WordSize) / WordConfiguration<Word>::WordSize;
+			assert(lastBacktraceOverrideStartJ > startSlice * WordConfiguration<Word>::WordSize);
+			size_t endSlice;
+			if (i == slice.slices.size()-1) endSlice = slice.bandwidthPerSlice.size(); else endSlice = (slice.slices[i+1].j + WordConfiguration<Word>::WordSize) / WordConfiguration<Word>::WordSize;
+			if (endSlice * WordConfiguration<Word>::WordSize >= lastBacktraceOverrideStartJ) endSlice = (lastBacktraceOverrideStartJ / WordConfiguration<Word>::WordSize);
+			assert(endSlice > startSlice);
+			assert(endSlice <= slice.bandwidthPerSlice.size());
+			assert(i == slice.slices.size() - 1 || result.second.size() > 0);
+			auto decodeStart = std::chrono::system_clock::now();
+			auto checkpoint = slice.slices[i].getDecompressedScores();
+			auto decodeEnd = std::chrono::system_clock::now();
+			stats.checkpointDecodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(decodeEnd - decodeStart).count();
+			traceSlices(sequence, slice, checkpoint, startSlice, endSlice, result, nodesliceMap);
 			if (slice.slices[i].j == nextBacktraceOverrideEndJ)
 			{
 				auto trace = slice.backtraceOverrides[backtraceOverrideIndex].GetBacktrace(result.second.back());
@@ -953,9 +1216,77 @@ private:
 #ifndef NDEBUG
 		verifyTrace(result.second, sequence, result.first, slice);
 #endif
+		auto backtraceEnd = std::chrono::system_clock::now();
+		stats.backtraceMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(backtraceEnd - backtraceStart).count();
 		return result;
 	}
 
+	//adds the trace through slices [startSlice, endSlice) and over the boundary into checkpoint, the slice before startSlice, to result
+	//an empty trace starts from the minimum of the last slice
+	//the slices are the stored full slices if the table has them. otherwise they're recalculated from the checkpoint,
+	//and if they don't fit in the memory budget the later half is traced first from a checkpoint recalculated at the middle,
+	//so only log(slices) checkpoints are kept at once
+	void traceSlices(const std::string& sequence, const DPTable& table, const DPSlice& checkpoint, size_t startSlice, size_t endSlice, std::pair<ScoreType, std::vector<MatrixPosition>>& result, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	{
+		assert(endSlice > startSlice);
+		assert(checkpoint.j + WordConfiguration<Word>::WordSize == startSlice * WordConfiguration<Word>::WordSize);
+		if (table.HasAllSlices())
+		{
+			//the full slices are compressed, decompress only this part. the slices inside backtrace overrides are empty
+			auto decodeStart = std::chrono::system_clock::now();
+			std::vector<DPSlice> partTable;
+			partTable.reserve(endSlice - startSlice);
+			for (size_t i = startSlice; i < endSlice; i++)
+			{
+				partTable.push_back(table.fullSlices[i].getDecompressedScores());
+			}
+			auto decodeEnd = std::chrono::system_clock::now();
+			stats.checkpointDecodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(decodeEnd - decodeStart).count();
+			traceSliceRange(sequence, partTable, 0, partTable.size(), checkpoint, result);
+			return;
+		}
+		size_t memory = 0;
+		for (size_t i = startSlice; i < endSlice; i++)
+		{
+			memory += table.memoryPerSlice[i];
+		}
+		if (memory <= table.memoryBudget || endSlice - startSlice == 1)
+		{
+			auto partTable = getSlicesFromTable(sequence, table, checkpoint, startSlice, endSlice, true, nodesliceMap);
+			traceSliceRange(sequence, partTable, 0, partTable.size(), checkpoint, result);
+			return;
+		}
+		stats.checkpointPolicy = std::max(stats.checkpointPolicy, AlignmentResult::RecursiveCheckpoints);
+		size_t middle = startSlice + (endSlice - startSlice) / 2;
+		{
+			auto middleCheckpoint = getSlicesFromTable(sequence, table, checkpoint, startSlice, middle, false, nodesliceMap);
+			assert(middleCheckpoint.size() == 1);
+			traceSlices(sequence, table, middleCheckpoint[0], middle, endSlice, result, nodesliceMap);
+		}
+		traceSlices(sequence, table, checkpoint, startSlice, middle, result, nodesliceMap);
+	}
+
+	//adds the trace through slices[first, last) and over the boundary into checkpoint to result
+	void traceSliceRange(const std::string& sequence, const std::vector<DPSlice>& slices, size_t first, size_t last, const DPSlice& checkpoint, std::pair<ScoreType, std::vector<MatrixPosition>>& result) const
+	{
+		assert(last > first);
+		assert(last <= slices.size());
+		assert(slices[first].j == checkpoint.j + WordConfiguration<Word>::WordSize);
+		if (result.second.size() == 0)
+		{
+			result.first = slices[last-1].minScore;
+			assert(slices[last-1].minScoreIndex.size() > 0);
+			result.second.emplace_back(slices[last-1].minScoreIndex.back(), slices[last-1].j + WordConfiguration<Word>::WordSize - 1);
+		}
+		auto partTrace = getTraceFromTableInner(sequence, slices, first, last, result.second.back());
+		assert(partTrace.size() > 1);
+		//begin()+1 because the starting position was already inserted earlier
+		result.second.insert(result.second.end(), partTrace.begin()+1, partTrace.end());
+		auto boundaryTrace = getSliceBoundaryTrace(sequence, slices[first], checkpoint, result.second.back().first);
+		result.second.insert(result.second.end(), boundaryTrace.begin(), boundaryTrace.end());
+		assert(boundaryTrace.size() > 0);
+	}
+
 	//returns the trace backwards, aka result[0] is at the bottom of the slice and result.back() at the top
 	std::vector<MatrixPosition> getTraceFromSlice(const std::string& sequence, const DPSlice& slice, MatrixPosition pos) const
 	{
@@ -992,15 +1323,16 @@ private:
 		return result;
 	}
 
-	//returns the trace backwards, aka result[0] is at the bottom of the table and result.back() at the top
-	std::vector<MatrixPosition> getTraceFromTableInner(const std::string& sequence, const std::vector<DPSlice>& table, MatrixPosition pos) const
+	//returns the trace backwards through table[first, last), aka result[0] is at the bottom of table[last-1] and result.back() at the top of table[first]
+	std::vector<MatrixPosition> getTraceFromTableInner(const std::string& sequence, const std::vector<DPSlice>& table, size_t first, size_t last, MatrixPosition pos) const
 	{
-		assert(table.size() > 0);
-		assert(pos.second >= table.back().j);
-		assert(pos.second < table.back().j + WordConfiguration<Word>::WordSize);
+		assert(last > first);
+		assert(last <= table.size());
+		assert(pos.second >= table[last-1].j);
+		assert(pos.second < table[last-1].j + WordConfiguration<Word>::WordSize);
 		std::vector<MatrixPosition> result;
 		result.push_back(pos);
-		for (size_t slice = table.size()-1; slice < table.size(); slice--)
+		for (size_t slice = last-1; slice >= first && slice < last; slice--)
 		{
 			assert(table[slice].j <= result.back().second);
 			assert(table[slice].j + WordConfiguration<Word>::WordSize > result.back().second);
@@ -1008,15 +1340,15 @@ private:
 			assert(partialTrace.size() >= WordConfiguration<Word>::WordSize - 1);
 			result.insert(result.end(), partialTrace.begin(), partialTrace.end());
 			assert(result.back().second == table[slice].j);
-			if (slice > 0)
+			if (slice > first)
 			{
 				auto boundaryTrace = getSliceBoundaryTrace(sequence, table[slice], table[slice-1], result.back().first);
 				result.insert(result.end(), boundaryTrace.begin(), boundaryTrace.end());
 				assert(result.back().second == table[slice-1].j + WordConfiguration<Word>::WordSize - 1);
 			}
 		}
-		assert(result.back().second == table[0].j);
-		assert(table[0].scores.hasNode(params.graph.IndexToNode(result.back().first)));
+		assert(result.back().second == table[first].j);
+		assert(table[first].scores.hasNode(params.graph.IndexToNode(result.back().first)));
 		return result;
 	}
 
@@ -1037,7 +1369,7 @@ private:
 		}
 	};
 
-	void filterReachableRec(std::set<LengthType>& result, const std::set<LengthType>& current, const std::vector<bool>& previousBand, LengthType start) const
+	void filterReachableRec(std::set<LengthType>& result, const std::set<LengthType>& current, const EpochBitVector& previousBand, LengthType start) const
 	{
 		std::vector<LengthType> stack;
 		stack.push_back(start);
@@ -1055,7 +1387,7 @@ private:
 		}
 	}
 
-	std::set<LengthType> filterOnlyReachable(const std::set<LengthType>& nodes, const std::vector<bool>& previousBand) const
+	std::set<LengthType> filterOnlyReachable(const std::set<LengthType>& nodes, const EpochBitVector& previousBand) const
 	{
 		std::set<LengthType> result;
 		for (auto node : nodes)
@@ -1107,60 +1439,79 @@ private:
 		int priority;
 	};
 
-	std::vector<LengthType> projectForwardFromMinScore(ScoreType minScore, const DPSlice& previousSlice, const std::vector<bool>& previousBand, int bandwidth) const
+	//the distances are small integers up to bandwidth + WordSize, so the queue is one bucket per distance
+	//and the distances are kept in the workspace, valid when their epoch is this projection's
+	std::vector<LengthType> projectForwardFromMinScore(ScoreType minScore, const DPSlice& previousSlice, const EpochBitVector& previousBand, int bandwidth) const
 	{
-		const auto expandWidth = bandwidth + WordConfiguration<Word>::WordSize;
-		std::unordered_map<size_t, size_t> distances;
+		const size_t expandWidth = bandwidth + WordConfiguration<Word>::WordSize;
+		auto& distances = workspace.projectionDistances;
+		auto& buckets = workspace.projectionBuckets;
+		const size_t epoch = ++workspace.projectionEpoch;
+		if (buckets.size() < expandWidth + 1) buckets.resize(expandWidth + 1);
+		for (size_t i = 0; i <= expandWidth; i++)
+		{
+			buckets[i].clear();
+		}
 		std::vector<LengthType> result;
-		std::priority_queue<NodeWithPriority, std::vector<NodeWithPriority>, std::greater<NodeWithPriority>> queue;
 		size_t currentWidth = 0;
+		size_t visited = 0;
 		for (const auto pair : previousSlice.scores)
 		{
 			if (pair.second.minScore() <= minScore + bandwidth)
 			{
 				auto node = pair.first;
-				distances[node] = 0;
+				distances[node] = std::make_pair(epoch, (size_t)0);
 				result.push_back(node);
+				visited++;
 				currentWidth += params.graph.NodeLength(node);
 				if (currentWidth >= params.AlternateMethodCutoff)
 				{
+					stats.projectedNodes += visited;
 					return result;
 				}
 				auto endscore = pair.second.back().scoreEnd;
 				assert(endscore >= minScore);
 				if (endscore > minScore + expandWidth) continue;
+				size_t distance = endscore - minScore + 1;
+				if (distance > expandWidth) continue;
 				for (auto neighbor : params.graph.outNeighbors[node])
 				{
-					queue.emplace(neighbor, endscore-minScore+1);
+					buckets[distance].push_back(neighbor);
 				}
 			}
 		}
-		assert(distances.size() > 0);
-		while (queue.size() > 0)
+		assert(result.size() > 0);
+		for (size_t distance = 0; distance <= expandWidth; distance++)
 		{
-			NodeWithPriority top = queue.top();
-			if (top.priority > expandWidth) break;
-			queue.pop();
-			if (distances.count(top.node) == 1 && distances[top.node] <= top.priority) continue;
-			currentWidth += params.graph.NodeLength(top.node);
-			distances[top.node] = top.priority;
-			result.push_back(top.node);
-			if (currentWidth >= params.AlternateMethodCutoff)
-			{
-				return result;
-			}
-			auto size = params.graph.NodeLength(top.node);
-			for (auto neighbor : params.graph.outNeighbors[top.node])
+			//everything pushed while processing a bucket goes to a later bucket
+			for (size_t i = 0; i < buckets[distance].size(); i++)
 			{
-				queue.emplace(neighbor, top.priority + size);
+				auto node = buckets[distance][i];
+				visited++;
+				if (distances[node].first == epoch && distances[node].second <= distance) continue;
+				currentWidth += params.graph.NodeLength(node);
+				distances[node] = std::make_pair(epoch, distance);
+				result.push_back(node);
+				if (currentWidth >= params.AlternateMethodCutoff)
+				{
+					stats.projectedNodes += visited;
+					return result;
+				}
+				auto next = distance + params.graph.NodeLength(node);
+				if (next > expandWidth) continue;
+				for (auto neighbor : params.graph.outNeighbors[node])
+				{
+					buckets[next].push_back(neighbor);
+				}
 			}
 		}
+		stats.projectedNodes += visited;
 		return result;
 	}
 
 #ifdef EXTRABITVECTORASSERTIONS
 
-	WordSlice getWordSliceCellByCell(size_t j, size_t w, const std::string& sequence, const NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<bool>& currentBand, const std::vector<bool>& previousBand) const
+	WordSlice getWordSliceCellByCell(size_t j, size_t w, const std::string& sequence, const NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const EpochBitVector& currentBand, const EpochBitVector& previousBand) const
 	{
 		const auto lastBitMask = ((Word)1) << (WordConfiguration<Word>::WordSize-1);
 		WordSlice result;
@@ -1267,7 +1618,7 @@ private:
 
 #endif
 
-	WordSlice getNodeStartSlice(const Word Eq, const size_t nodeIndex, const NodeSlice<WordSlice>& previousSlice, const NodeSlice<WordSlice>& currentSlice, const std::vector<bool>& currentBand, const std::vector<bool>& previousBand, const bool previousEq) const
+	WordSlice getNodeStartSlice(const Word Eq, const size_t nodeIndex, const NodeSlice<WordSlice>& previousSlice, const NodeSlice<WordSlice>& currentSlice, const EpochBitVector& currentBand, const EpochBitVector& previousBand, const bool previousEq) const
 	{
 		const WordSlice current = currentSlice.node(nodeIndex)[0];
 		WordSlice result;
@@ -1326,8 +1677,8 @@ private:
 
 	WordSlice getSourceSliceFromStartMatch(char sequenceChar, char graphChar, ScoreType previousScore) const
 	{
-		Word firstVP = characterMatch(sequenceChar, graphChar) ? 0 : 1;
-		return { WordConfiguration<Word>::AllOnes & ~(Word)1 | firstVP, WordConfiguration<Word>::AllZeros, previousScore+WordConfiguration<Word>::WordSize - 1 + firstVP, previousScore, WordConfiguration<Word>::WordSize, true };
+		int firstVP = characterMatch(sequenceChar, graphChar) ? 0 : 1;
+		return { (WordConfiguration<Word>::AllOnes & ~(Word)1) | (Word)firstVP, WordConfiguration<Word>::AllZeros, previousScore+WordConfiguration<Word>::WordSize - 1 + firstVP, previousScore, WordConfiguration<Word>::WordSize, true };
 	}
 
 	WordSlice getSourceSliceFromBefore(size_t nodeIndex, const NodeSlice<WordSlice>& previousSlice) const
@@ -1336,7 +1687,7 @@ private:
 		return { WordConfiguration<Word>::AllOnes, WordConfiguration<Word>::AllZeros, previousWordSlice.scoreEnd+WordConfiguration<Word>::WordSize, previousWordSlice.scoreEnd, WordConfiguration<Word>::WordSize, previousWordSlice.scoreEndExists };
 	}
 
-	bool isSource(size_t nodeIndex, const std::vector<bool>& currentBand, const std::vector<bool>& previousBand) const
+	bool isSource(size_t nodeIndex, const EpochBitVector& currentBand, const EpochBitVector& previousBand) const
 	{
 		for (auto neighbor : params.graph.inNeighbors[nodeIndex])
 		{
@@ -1454,7 +1805,7 @@ private:
 #endif
 	}
 
-	NodeCalculationResult calculateNode(size_t i, size_t j, const std::string& sequence, const EqVector& EqV, NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<bool>& currentBand, const std::vector<bool>& previousBand) const
+	NodeCalculationResult calculateNode(size_t i, size_t j, const std::string& sequence, const EqVector& EqV, NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const EpochBitVector& currentBand, const EpochBitVector& previousBand) const
 	{
 		NodeCalculationResult result;
 		result.minScore = std::numeric_limits<ScoreType>::max();
@@ -1463,6 +1814,9 @@ private:
 		const auto oldSlice = previousBand[i] ? previousSlice.node(i) : slice;
 		assert(slice.size() == params.graph.NodeEnd(i) - params.graph.NodeStart(i));
 		auto nodeStart = params.graph.NodeStart(i);
+		//the bases are read 32 at a time as 2-bit codes unless the node has ambiguous bases
+		const bool packedBases = !params.graph.NodeHasAmbiguousBases(i);
+		uint64_t codes = packedBases ? params.graph.NodeSequenceCodes(nodeStart) : 0;
 
 #ifdef EXTRABITVECTORASSERTIONS
 		WordSlice correctstart;
@@ -1499,8 +1853,19 @@ private:
 		}
 		else
 		{
-			Word Eq = EqV.getEq(params.graph.NodeSequences(nodeStart));
-			slice[0] = getNodeStartSlice(Eq, i, previousSlice, currentSlice, currentBand, previousBand, (j == 0 && previousBand[i]) || (j > 0 && params.graph.NodeSequences(params.graph.NodeStart(i)) == sequence[j-1]));
+			char graphChar;
+			Word Eq;
+			if (packedBases)
+			{
+				graphChar = "ATCG"[codes & 3];
+				Eq = EqV.getEqByCode(codes & 3);
+			}
+			else
+			{
+				graphChar = params.graph.NodeSequences(nodeStart);
+				Eq = EqV.getEq(graphChar);
+			}
+			slice[0] = getNodeStartSlice(Eq, i, previousSlice, currentSlice, currentBand, previousBand, (j == 0 && previousBand[i]) || (j > 0 && graphChar == sequence[j-1]));
 			if (previousBand[i] && slice[0].scoreBeforeStart > oldSlice[0].scoreEnd)
 			{
 				auto mergable = getSourceSliceFromScore(oldSlice[0].scoreEnd);
@@ -1532,12 +1897,24 @@ private:
 
 		for (LengthType w = 1; w < params.graph.NodeEnd(i) - params.graph.NodeStart(i); w++)
 		{
-			Word Eq = EqV.getEq(params.graph.NodeSequences(nodeStart+w));
+			char graphChar;
+			Word Eq;
+			if (packedBases)
+			{
+				if (w % 32 == 0) codes = params.graph.NodeSequenceCodes(nodeStart+w); else codes >>= 2;
+				graphChar = "ATCG"[codes & 3];
+				Eq = EqV.getEqByCode(codes & 3);
+			}
+			else
+			{
+				graphChar = params.graph.NodeSequences(nodeStart+w);
+				Eq = EqV.getEq(graphChar);
+			}
 
 			oldConfirmation = slice[w].confirmedRows;
 			if (oldConfirmation.rows == WordConfiguration<Word>::WordSize) return result;
 
-			slice[w] = getNextSlice(Eq, slice[w-1], slice[w].scoreBeforeExists, slice[w].scoreBeforeExists, slice[w-1].scoreBeforeExists, (j == 0 && previousBand[i]) || (j > 0 && params.graph.NodeSequences(nodeStart+w) == sequence[j-1]), oldSlice[w-1]);
+			slice[w] = getNextSlice(Eq, slice[w-1], slice[w].scoreBeforeExists, slice[w].scoreBeforeExists, slice[w-1].scoreBeforeExists, (j == 0 && previousBand[i]) || (j > 0 && graphChar == sequence[j-1]), oldSlice[w-1]);
 			if (previousBand[i] && slice[w].scoreBeforeStart > oldSlice[w].scoreEnd)
 			{
 				auto mergable = getSourceSliceFromScore(oldSlice[w].scoreEnd);
@@ -1572,12 +1949,12 @@ private:
 		return result;
 	}
 
-	std::vector<LengthType> forwardFromMinScoreBandFunction(const std::vector<bool>& previousBand, const DPSlice& previousSlice, int bandwidth) const
+	std::vector<LengthType> forwardFromMinScoreBandFunction(const EpochBitVector& previousBand, const DPSlice& previousSlice, int bandwidth) const
 	{
 		return projectForwardFromMinScore(previousSlice.minScore, previousSlice, previousBand, bandwidth);
 	}
 
-	std::vector<LengthType> rowBandFunction(const DPSlice& previousSlice, const std::vector<bool>& previousBand, int bandwidth) const
+	std::vector<LengthType> rowBandFunction(const DPSlice& previousSlice, const EpochBitVector& previousBand, int bandwidth) const
 	{
 		return forwardFromMinScoreBandFunction(previousBand, previousSlice, bandwidth);
 	}
@@ -1754,9 +2131,9 @@ private:
 		ComponentAlgorithmCallStack(LengthType nodeIndex, int state) : nodeIndex(nodeIndex), state(state) {}
 		LengthType nodeIndex;
 		int state;
-		std::vector<size_t>::const_iterator neighborIterator;
+		const size_t* neighborIterator;
 	};
-	void getStronglyConnectedComponentsRec(LengthType start, const std::vector<bool>& currentBand, std::unordered_map<LengthType, size_t>& index, std::unordered_map<LengthType, size_t>& lowLink, size_t& stackindex, std::unordered_set<LengthType>& onStack, std::vector<LengthType>& stack, std::vector<std::vector<LengthType>>& result) const
+	void getStronglyConnectedComponentsRec(LengthType start, size_t graphComponent, const EpochBitVector& currentBand, std::unordered_map<LengthType, size_t>& index, std::unordered_map<LengthType, size_t>& lowLink, size_t& stackindex, std::unordered_set<LengthType>& onStack, std::vector<LengthType>& stack, std::vector<std::vector<LengthType>>& result) const
 	{
 		assert(currentBand[start]);
 		std::vector<ComponentAlgorithmCallStack> callStack;
@@ -1785,7 +2162,7 @@ private:
 				if (iterator == params.graph.outNeighbors[nodeIndex].end()) goto end;
 				neighbor = *iterator;
 				//neighbor not in the subgraph, go to next
-				if (!currentBand[neighbor])
+				if (!currentBand[neighbor] || params.graph.componentNumber[neighbor] != graphComponent)
 				{
 					++iterator;
 					goto startloop;
@@ -1833,14 +2210,15 @@ private:
 	}
 
 	//https://en.wikipedia.org/wiki/Tarjan%27s_strongly_connected_components_algorithm
-	std::vector<std::vector<LengthType>> getStronglyConnectedComponents(const std::vector<size_t>& nodes, const std::vector<bool>& currentBand) const
+	//the band's components inside one component of the graph, which is cyclic and falls apart when only a part of it is in the band
+	std::vector<std::vector<LengthType>> getStronglyConnectedComponentsInside(const std::vector<LengthType>& nodes, size_t graphComponent, const EpochBitVector& currentBand) const
 	{
 		std::vector<std::vector<LengthType>> result;
 		std::unordered_map<LengthType, size_t> index;
 		std::unordered_map<LengthType, size_t> lowLink;
 		size_t stackIndex = 0;
-		std::unordered_set<size_t> onStack;
-		std::vector<size_t> stack;
+		std::unordered_set<LengthType> onStack;
+		std::vector<LengthType> stack;
 		stack.reserve(nodes.size());
 		index.reserve(nodes.size());
 		lowLink.reserve(nodes.size());
@@ -1848,9 +2226,10 @@ private:
 		for (auto node : nodes)
 		{
 			assert(currentBand[node]);
+			assert(params.graph.componentNumber[node] == graphComponent);
 			if (index.count(node) == 0)
 			{
-				getStronglyConnectedComponentsRec(node, currentBand, index, lowLink, stackIndex, onStack, stack, result);
+				getStronglyConnectedComponentsRec(node, graphComponent, currentBand, index, lowLink, stackIndex, onStack, stack, result);
 			}
 		}
 		result.shrink_to_fit();
@@ -1858,6 +2237,41 @@ private:
 		assert(onStack.size() == 0);
 		assert(index.size() == nodes.size());
 		assert(lowLink.size() == nodes.size());
+		return result;
+	}
+
+	//the graph's components don't change so they're calculated once in AlignmentGraph::Finalize.
+	//the band's components are in the same order as the graph's components, and only
+	//graph components with several nodes in the band need tarjan's algorithm to split them further
+	std::vector<std::vector<LengthType>> getStronglyConnectedComponents(const std::vector<LengthType>& nodes, const EpochBitVector& currentBand) const
+	{
+		std::vector<std::pair<size_t, LengthType>> order;
+		order.reserve(nodes.size());
+		for (auto node : nodes)
+		{
+			assert(currentBand[node]);
+			order.emplace_back(params.graph.componentNumber[node], node);
+		}
+		//reverse topological order like tarjan's algorithm gives, the slice is calculated from the last component to the first.
+		//the nodes of a component keep their band order, it decides where tarjan's algorithm starts and the order inside the component
+		std::stable_sort(order.begin(), order.end(), [](const std::pair<size_t, LengthType>& left, const std::pair<size_t, LengthType>& right) { return left.first > right.first; });
+		std::vector<std::vector<LengthType>> result;
+		std::vector<LengthType> group;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			group.push_back(order[i].second);
+			if (i+1 < order.size() && order[i+1].first == order[i].first) continue;
+			if (group.size() == 1)
+			{
+				result.emplace_back(group);
+			}
+			else
+			{
+				auto parts = getStronglyConnectedComponentsInside(group, order[i].first, currentBand);
+				result.insert(result.end(), std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+			}
+			group.clear();
+		}
 #ifndef NDEBUG
 		std::unordered_set<size_t> debugFoundNodes;
 		std::unordered_map<size_t, size_t> debugComponentIndex;
@@ -1885,7 +2299,7 @@ private:
 				{
 					if (!currentBand[neighbor]) continue;
 					assert(debugComponentIndex.count(neighbor) == 1);
-					assert(debugComponentIndex[neighbor] <= debugComponenti);
+					assert(debugComponentIndex[neighbor] <= debugComponentIndex[node]);
 				}
 			}
 		}
@@ -1900,7 +2314,7 @@ private:
 		return result;
 	}
 
-	void forceComponentZeroRow(NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<bool>& currentBand, const std::vector<bool>& previousBand, const std::vector<LengthType>& component, size_t componentIndex, const std::vector<size_t>& partOfComponent, size_t sequenceLen) const
+	void forceComponentZeroRow(NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const EpochBitVector& currentBand, const EpochBitVector& previousBand, const std::vector<LengthType>& component, size_t componentIndex, const EpochVector<size_t>& partOfComponent, size_t sequenceLen) const
 	{
 		std::priority_queue<NodeWithPriority, std::vector<NodeWithPriority>, std::greater<NodeWithPriority>> queue;
 		for (auto node : component)
@@ -2036,9 +2450,70 @@ private:
 		return word.getValue(off);
 	}
 
+	//the bases a character can be as bits in ATCG order, 0 if it's not a base
+	static int baseMask(char character)
+	{
+		switch(character)
+		{
+			case 'A':
+			case 'a':
+			return 1;
+			case 'T':
+			case 't':
+			return 2;
+			case 'C':
+			case 'c':
+			return 4;
+			case 'G':
+			case 'g':
+			return 8;
+			case 'N':
+			case 'n':
+			return 15;
+			case 'R':
+			case 'r':
+			return 1 | 8;
+			case 'Y':
+			case 'y':
+			return 4 | 2;
+			case 'K':
+			case 'k':
+			return 8 | 2;
+			case 'M':
+			case 'm':
+			return 4 | 1;
+			case 'S':
+			case 's':
+			return 4 | 8;
+			case 'W':
+			case 'w':
+			return 1 | 2;
+			case 'B':
+			case 'b':
+			return 4 | 8 | 2;
+			case 'D':
+			case 'd':
+			return 1 | 8 | 2;
+			case 'H':
+			case 'h':
+			return 1 | 4 | 2;
+			case 'V':
+			case 'v':
+			return 1 | 4 | 8;
+			default:
+			return 0;
+		}
+	}
+
 	static bool characterMatch(char sequenceCharacter, char graphCharacter)
 	{
-		assert(graphCharacter == 'A' || graphCharacter == 'T' || graphCharacter == 'C' || graphCharacter == 'G');
+		if (graphCharacter != 'A' && graphCharacter != 'T' && graphCharacter != 'C' && graphCharacter != 'G')
+		{
+			//ambiguous graph base, IUPAC codes match if they have a base in common
+			assert(baseMask(graphCharacter) != 0);
+			assert(baseMask(sequenceCharacter) != 0);
+			return baseMask(sequenceCharacter) & baseMask(graphCharacter);
+		}
 		switch(sequenceCharacter)
 		{
 			case 'A':
@@ -2145,7 +2620,7 @@ private:
 		nodeslice[index].setValue(row, value);
 	}
 
-	NodeCalculationResult calculateSliceAlternate(const std::string& sequence, size_t startj, NodeSlice<WordSlice>& currentSlice, const DPSlice& previousSlice, std::vector<bool>& processed, int bandwidth) const
+	NodeCalculationResult calculateSliceAlternate(const std::string& sequence, size_t startj, NodeSlice<WordSlice>& currentSlice, const DPSlice& previousSlice, EpochBitVector& processed, int bandwidth) const
 	{
 		std::vector<std::vector<std::pair<LengthType, LengthType>>> calculables;
 		std::vector<std::vector<std::pair<LengthType, LengthType>>> nextCalculables;
@@ -2234,7 +2709,7 @@ private:
 				{
 					if (processed[pair.second]) continue;
 					cellsProcessed++;
-					processed[pair.second] = true;
+					processed.set(pair.second, true);
 					processedlist.push_back(pair.second);
 					auto nodeStart = params.graph.NodeStart(pair.first);
 					auto nodeEnd = params.graph.NodeEnd(pair.first);
@@ -2304,7 +2779,7 @@ private:
 			for (auto cell : processedlist)
 			{
 				assert(processed[cell]);
-				processed[cell] = false;
+				processed.set(cell, false);
 			}
 			processedlist.clear();
 			if (j < WordConfiguration<Word>::WordSize - 1)
@@ -2328,7 +2803,234 @@ private:
 		return result;
 	}
 
-	NodeCalculationResult calculateSlice(const std::string& sequence, size_t j, NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<LengthType>& bandOrder, const std::vector<bool>& currentBand, const std::vector<bool>& previousBand, std::vector<size_t>& partOfComponent, UniqueQueue<LengthType>& calculables) const
+	//calculables of one component when components are calculated on several threads
+	//like UniqueQueue but sized to the component instead of the graph
+	class ComponentQueue
+	{
+	public:
+		ComponentQueue(const std::vector<LengthType>& indexInComponent, size_t componentSize) :
+		indexInComponent(indexInComponent),
+		hasItem(componentSize, false)
+		{
+		}
+		void insert(LengthType node)
+		{
+			if (hasItem[indexInComponent[node]]) return;
+			hasItem[indexInComponent[node]] = true;
+			items.push_back(node);
+		}
+		template <typename Iterator>
+		void insert(Iterator start, Iterator end)
+		{
+			for (; start != end; ++start)
+			{
+				insert(*start);
+			}
+		}
+		size_t size() const
+		{
+			return items.size();
+		}
+		LengthType top() const
+		{
+			return items.back();
+		}
+		void pop()
+		{
+			assert(hasItem[indexInComponent[items.back()]]);
+			hasItem[indexInComponent[items.back()]] = false;
+			items.pop_back();
+		}
+	private:
+		const std::vector<LengthType>& indexInComponent;
+		std::vector<bool> hasItem;
+		std::vector<LengthType> items;
+	};
+
+	//only reads the nodes of the components before it, and only writes its own nodes
+	template <typename Queue>
+	NodeCalculationResult calculateComponent(const std::string& sequence, size_t j, const EqVector& EqV, NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<LengthType>& component, size_t componentIndex, const EpochBitVector& currentBand, const EpochBitVector& previousBand, const EpochVector<size_t>& partOfComponent, Queue& calculables) const
+	{
+		NodeCalculationResult result;
+		result.minScore = std::numeric_limits<ScoreType>::max();
+		result.cellsProcessed = 0;
+		forceComponentZeroRow(currentSlice, previousSlice, currentBand, previousBand, component, componentIndex, partOfComponent, sequence.size());
+		assert(calculables.size() == 0);
+		calculables.insert(component.begin(), component.end());
+		while (calculables.size() > 0)
+		{
+			auto i = calculables.top();
+			assert(currentBand[i]);
+			calculables.pop();
+			auto oldEnd = currentSlice.node(i).back();
+#ifdef EXTRACORRECTNESSASSERTIONS
+			auto debugOldNode = currentSlice.node(i);
+#endif
+			auto nodeCalc = calculateNode(i, j, sequence, EqV, currentSlice, previousSlice, currentBand, previousBand);
+			currentSlice.setMinScore(i, nodeCalc.minScore);
+			auto newEnd = currentSlice.node(i).back();
+#ifdef EXTRACORRECTNESSASSERTIONS
+			auto debugNewNode = currentSlice.node(i);
+			for (size_t debugi = 0; debugi < debugOldNode.size(); debugi++)
+			{
+				assertBitvectorConfirmedAreConsistent(debugNewNode[debugi], debugOldNode[debugi]);
+				assert(debugNewNode[debugi].confirmedRows >= debugOldNode[debugi].confirmedRows);
+			}
+#endif
+			assert(newEnd.scoreBeforeStart == oldEnd.scoreBeforeStart);
+			assert(newEnd.confirmedRows >= oldEnd.confirmedRows);
+			if (newEnd.scoreBeforeStart < (ScoreType)sequence.size() && newEnd.confirmedRows > oldEnd.confirmedRows)
+			{
+				for (auto neighbor : params.graph.outNeighbors[i])
+				{
+					if (partOfComponent[neighbor] != componentIndex) continue;
+					if (currentSlice.node(neighbor)[0].confirmedRows.rows < WordConfiguration<Word>::WordSize)
+					{
+						calculables.insert(neighbor);
+					}
+				}
+			}
+#ifndef NDEBUG
+			auto debugslice = currentSlice.node(i);
+			if (nodeCalc.minScore != std::numeric_limits<ScoreType>::max())
+			{
+				for (auto index : nodeCalc.minScoreIndex)
+				{
+					assert(index >= params.graph.NodeStart(i));
+					assert(index < params.graph.NodeEnd(i));
+					assert(debugslice[index - params.graph.NodeStart(i)].scoreEnd == nodeCalc.minScore);
+				}
+			}
+#endif
+			if (nodeCalc.minScore < result.minScore)
+			{
+				result.minScore = nodeCalc.minScore;
+				result.minScoreIndex.clear();
+			}
+			if (nodeCalc.minScore == result.minScore)
+			{
+				result.minScoreIndex.insert(result.minScoreIndex.end(), nodeCalc.minScoreIndex.begin(), nodeCalc.minScoreIndex.end());
+			}
+			result.cellsProcessed += nodeCalc.cellsProcessed;
+		}
+#ifndef NDEBUG
+		for (auto node : component)
+		{
+			assert(currentSlice.node(node)[0].confirmedRows.rows == WordConfiguration<Word>::WordSize);
+		}
+#endif
+		return result;
+	}
+
+	//a component only depends on the components with edges into it, so components without a path between them can be calculated at the same time.
+	//a task continues into a successor which became ready so chains of components stay on one thread.
+	//results are per component and merged in the sequential order so the alignment doesn't depend on the scheduling
+	std::vector<NodeCalculationResult> calculateComponentsParallel(ComponentThreadPool& pool, const std::string& sequence, size_t j, const EqVector& EqV, NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<std::vector<LengthType>>& components, const EpochBitVector& currentBand, const EpochBitVector& previousBand, const EpochVector<size_t>& partOfComponent) const
+	{
+		auto& indexInComponent = workspace.indexInComponent;
+		if (indexInComponent.size() == 0) indexInComponent.resize(params.graph.NodeSize());
+		std::vector<NodeCalculationResult> results;
+		results.resize(components.size());
+		std::vector<std::vector<size_t>> successors;
+		successors.resize(components.size());
+		std::unique_ptr<std::atomic<size_t>[]> waitingFor { new std::atomic<size_t>[components.size()] };
+		for (size_t i = 0; i < components.size(); i++)
+		{
+			waitingFor[i] = 0;
+			for (size_t k = 0; k < components[i].size(); k++)
+			{
+				indexInComponent[components[i][k]] = k;
+			}
+		}
+		for (size_t i = 0; i < components.size(); i++)
+		{
+			for (auto node : components[i])
+			{
+				for (auto neighbor : params.graph.outNeighbors[node])
+				{
+					if (!currentBand[neighbor]) continue;
+					if (partOfComponent[neighbor] == i) continue;
+					//tarjan's algorithm returns the components in reverse topological order
+					assert(partOfComponent[neighbor] < i);
+					successors[i].push_back(partOfComponent[neighbor]);
+				}
+			}
+			std::sort(successors[i].begin(), successors[i].end());
+			successors[i].erase(std::unique(successors[i].begin(), successors[i].end()), successors[i].end());
+			for (auto successor : successors[i])
+			{
+				waitingFor[successor]++;
+			}
+		}
+		std::atomic<size_t> remaining { components.size() };
+		std::atomic<bool> failed { false };
+		std::exception_ptr error;
+		int lastRowMinScore = 0;
+#ifndef NDEBUG
+		//the slice assertions compare against the calling thread's row minimum
+		lastRowMinScore = debugLastRowMinScore;
+#endif
+		std::function<void(size_t)> run;
+		run = [this, &pool, &run, &remaining, &failed, &error, &results, &successors, &waitingFor, &indexInComponent, &components, &sequence, j, &EqV, &currentSlice, &previousSlice, &currentBand, &previousBand, &partOfComponent, lastRowMinScore](size_t component)
+		{
+			//the caller's locals are gone as soon as remaining reaches zero
+			auto& taskPool = pool;
+#ifndef NDEBUG
+			debugLastRowMinScore = lastRowMinScore;
+#endif
+			while (true)
+			{
+				if (!failed)
+				{
+					try
+					{
+						ComponentQueue calculables { indexInComponent, components[component].size() };
+						results[component] = calculateComponent(sequence, j, EqV, currentSlice, previousSlice, components[component], component, currentBand, previousBand, partOfComponent, calculables);
+					}
+					catch (...)
+					{
+						bool expected = false;
+						if (failed.compare_exchange_strong(expected, true)) error = std::current_exception();
+					}
+				}
+				size_t next = std::numeric_limits<size_t>::max();
+				for (auto successor : successors[component])
+				{
+					if (--waitingFor[successor] != 0) continue;
+					if (next == std::numeric_limits<size_t>::max())
+					{
+						next = successor;
+					}
+					else
+					{
+						pool.submit([&run, successor]() { run(successor); });
+					}
+				}
+				if (--remaining == 0)
+				{
+					taskPool.notifyDone();
+					return;
+				}
+				if (next == std::numeric_limits<size_t>::max()) return;
+				component = next;
+			}
+		};
+		//collect the sources before submitting anything, the tasks start decrementing waitingFor right away
+		std::vector<size_t> sources;
+		for (size_t component = components.size()-1; component < components.size(); component--)
+		{
+			if (waitingFor[component] == 0) sources.push_back(component);
+		}
+		for (auto component : sources)
+		{
+			pool.submit([&run, component]() { run(component); });
+		}
+		pool.helpUntil([&remaining]() { return remaining == 0; });
+		if (error) std::rethrow_exception(error);
+		return results;
+	}
+
+	NodeCalculationResult calculateSlice(const std::string& sequence, size_t j, NodeSlice<WordSlice>& currentSlice, const NodeSlice<WordSlice>& previousSlice, const std::vector<LengthType>& bandOrder, const EpochBitVector& currentBand, const EpochBitVector& previousBand, EpochVector<size_t>& partOfComponent, UniqueQueue<LengthType>& calculables) const
 	{
 		ScoreType currentMinimumScore = std::numeric_limits<ScoreType>::max();
 		std::vector<LengthType> currentMinimumIndex;
@@ -2354,82 +3056,52 @@ private:
 		{
 			for (auto node : components[i])
 			{
-				partOfComponent[node] = i;
+				partOfComponent.set(node, i);
+			}
+		}
+		bool parallel = false;
+		if (workspace.componentPool != nullptr && components.size() > 1)
+		{
+			size_t bandCells = 0;
+			for (auto node : bandOrder)
+			{
+				bandCells += params.graph.NodeLength(node);
+			}
+			parallel = bandCells >= params.ParallelComponentCutoff;
+		}
+		std::vector<NodeCalculationResult> componentResults;
+		if (parallel)
+		{
+			componentResults = calculateComponentsParallel(*workspace.componentPool, sequence, j, EqV, currentSlice, previousSlice, components, currentBand, previousBand, partOfComponent);
+			stats.parallelSlices++;
+		}
+		else
+		{
+			componentResults.resize(components.size());
+			for (size_t component = components.size()-1; component < components.size(); component--)
+			{
+				componentResults[component] = calculateComponent(sequence, j, EqV, currentSlice, previousSlice, components[component], component, currentBand, previousBand, partOfComponent, calculables);
 			}
 		}
 		for (size_t component = components.size()-1; component < components.size(); component--)
 		{
-			forceComponentZeroRow(currentSlice, previousSlice, currentBand, previousBand, components[component], component, partOfComponent, sequence.size());
-			assert(calculables.size() == 0);
-			calculables.insert(components[component].begin(), components[component].end());
-			while (calculables.size() > 0)
+			auto& componentResult = componentResults[component];
+			if (componentResult.minScore < currentMinimumScore)
 			{
-				auto i = calculables.top();
-				assert(currentBand[i]);
-				calculables.pop();
-				auto oldEnd = currentSlice.node(i).back();
-#ifdef EXTRACORRECTNESSASSERTIONS
-				auto debugOldNode = currentSlice.node(i);
-#endif
-				auto nodeCalc = calculateNode(i, j, sequence, EqV, currentSlice, previousSlice, currentBand, previousBand);
-				currentSlice.setMinScore(i, nodeCalc.minScore);
-				auto newEnd = currentSlice.node(i).back();
-#ifdef EXTRACORRECTNESSASSERTIONS
-				auto debugNewNode = currentSlice.node(i);
-				for (size_t debugi = 0; debugi < debugOldNode.size(); debugi++)
-				{
-					assertBitvectorConfirmedAreConsistent(debugNewNode[debugi], debugOldNode[debugi]);
-					assert(debugNewNode[debugi].confirmedRows >= debugOldNode[debugi].confirmedRows);
-				}
-#endif
-				assert(newEnd.scoreBeforeStart == oldEnd.scoreBeforeStart);
-				assert(newEnd.confirmedRows >= oldEnd.confirmedRows);
-				if (newEnd.scoreBeforeStart < sequence.size() && newEnd.confirmedRows > oldEnd.confirmedRows)
-				{
-					for (auto neighbor : params.graph.outNeighbors[i])
-					{
-						if (partOfComponent[neighbor] != component) continue;
-						if (currentSlice.node(neighbor)[0].confirmedRows.rows < WordConfiguration<Word>::WordSize)
-						{
-							calculables.insert(neighbor);
-						}
-					}
-				}
-#ifndef NDEBUG
-				auto debugslice = currentSlice.node(i);
-				if (nodeCalc.minScore != std::numeric_limits<ScoreType>::max())
-				{
-					for (auto index : nodeCalc.minScoreIndex)
-					{
-						assert(index >= params.graph.NodeStart(i));
-						assert(index < params.graph.NodeEnd(i));
-						assert(debugslice[index - params.graph.NodeStart(i)].scoreEnd == nodeCalc.minScore);
-					}
-				}
-#endif
-				if (nodeCalc.minScore < currentMinimumScore)
-				{
-					currentMinimumScore = nodeCalc.minScore;
-					currentMinimumIndex.clear();
-				}
-				if (nodeCalc.minScore == currentMinimumScore)
-				{
-					currentMinimumIndex.insert(currentMinimumIndex.end(), nodeCalc.minScoreIndex.begin(), nodeCalc.minScoreIndex.end());
-				}
-				cellsProcessed += nodeCalc.cellsProcessed;
+				currentMinimumScore = componentResult.minScore;
+				currentMinimumIndex.clear();
 			}
-#ifndef NDEBUG
-			for (auto node : components[component])
+			if (componentResult.minScore == currentMinimumScore)
 			{
-				assert(currentSlice.node(node)[0].confirmedRows.rows == WordConfiguration<Word>::WordSize);
+				currentMinimumIndex.insert(currentMinimumIndex.end(), componentResult.minScoreIndex.begin(), componentResult.minScoreIndex.end());
 			}
-#endif
+			cellsProcessed += componentResult.cellsProcessed;
 		}
 		for (size_t i = 0; i < components.size(); i++)
 		{
 			for (auto node : components[i])
 			{
-				partOfComponent[node] = std::numeric_limits<size_t>::max();
+				partOfComponent.set(node, std::numeric_limits<size_t>::max());
 			}
 		}
 
@@ -2450,7 +3122,7 @@ private:
 		return result;
 	}
 
-	DPSlice extendDPSlice(const DPSlice& previous, const std::vector<bool>& previousBand, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap, int bandwidth) const
+	DPSlice extendDPSlice(const DPSlice& previous, const EpochBitVector& previousBand, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap, int bandwidth) const
 	{
 		DPSlice result { &nodesliceMap };
 		result.j = previous.j + WordConfiguration<Word>::WordSize;
@@ -2460,7 +3132,7 @@ private:
 		return result;
 	}
 
-	void fillDPSlice(const std::string& sequence, DPSlice& slice, const DPSlice& previousSlice, const std::vector<bool>& previousBand, std::vector<size_t>& partOfComponent, const std::vector<bool>& currentBand, UniqueQueue<LengthType>& calculables) const
+	void fillDPSlice(const std::string& sequence, DPSlice& slice, const DPSlice& previousSlice, const EpochBitVector& previousBand, EpochVector<size_t>& partOfComponent, const EpochBitVector& currentBand, UniqueQueue<LengthType>& calculables) const
 	{
 		auto sliceResult = calculateSlice(sequence, slice.j, slice.scores, previousSlice.scores, slice.nodes, currentBand, previousBand, partOfComponent, calculables);
 		slice.cellsProcessed = sliceResult.cellsProcessed;
@@ -2470,7 +3142,7 @@ private:
 		slice.correctness = slice.correctness.NextState(slice.minScore - previousSlice.minScore, WordConfiguration<Word>::WordSize);
 	}
 
-	DPSlice pickMethodAndExtendFill(const std::string& sequence, const DPSlice& previous, const std::vector<bool>& previousBand, std::vector<bool>& currentBand, std::vector<size_t>& partOfComponent, UniqueQueue<LengthType>& calculables, std::vector<bool>& processed, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap, int bandwidth) const
+	DPSlice pickMethodAndExtendFill(const std::string& sequence, const DPSlice& previous, const EpochBitVector& previousBand, EpochBitVector& currentBand, EpochVector<size_t>& partOfComponent, UniqueQueue<LengthType>& calculables, EpochBitVector& processed, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap, int bandwidth) const
 	{
 		{ //braces so bandTest doesn't take memory later
 			auto bandTest = extendDPSlice(previous, previousBand, nodesliceMap, bandwidth);
@@ -2486,10 +3158,11 @@ private:
 				for (auto node : bandTest.nodes)
 				{
 					bandTest.scores.addNode(node, params.graph.NodeLength(node));
-					currentBand[node] = true;
+					currentBand.set(node, true);
 				}
 				fillDPSlice(sequence, bandTest, previous, previousBand, partOfComponent, currentBand, calculables);
 				bandTest.numCells = cells;
+				stats.bitvectorSlices++;
 
 #ifdef EXTRACORRECTNESSASSERTIONS
 				verifySliceBitvector(sequence, bandTest, previous);
@@ -2504,6 +3177,7 @@ private:
 			result.scores.reserve(params.AlternateMethodCutoff);
 
 			auto sliceResult = calculateSliceAlternate(sequence, result.j, result.scores, previous, processed, bandwidth);
+			stats.alternateSlices++;
 			result.cellsProcessed = sliceResult.cellsProcessed;
 			result.minScoreIndex = sliceResult.minScoreIndex;
 			result.minScore = sliceResult.minScore;
@@ -2520,14 +3194,14 @@ private:
 		}
 	}
 
-	void finalizeAlternateSlice(DPSlice& slice, std::vector<bool>& currentBand, ScoreType uninitializedValue, int bandwidth) const
+	void finalizeAlternateSlice(DPSlice& slice, EpochBitVector& currentBand, ScoreType uninitializedValue, int bandwidth) const
 	{
 		for (auto pair : slice.scores)
 		{
 			auto node = pair.first;
 			slice.nodes.push_back(node);
 			assert(!currentBand[node]);
-			currentBand[node] = true;
+			currentBand.set(node, true);
 			ScoreType minScore = pair.second[0].scoreEnd;
 			for (auto& word : pair.second)
 			{
@@ -2566,28 +3240,38 @@ private:
 			table.slices.clear();
 		}
 		while (table.slices.size() > 1 && table.slices.back().j >= table.correctness.size() * WordConfiguration<Word>::WordSize) table.slices.pop_back();
+		while (table.fullSlices.size() > table.correctness.size())
+		{
+			table.fullSlicesMemory -= table.fullSlices.back().StoredMemoryUsage();
+			table.fullSlices.pop_back();
+		}
+		while (table.memoryPerSlice.size() > table.correctness.size()) table.memoryPerSlice.pop_back();
+		while (table.minScorePerSlice.size() > table.correctness.size()) table.minScorePerSlice.pop_back();
 	}
 
-	DPTable getSqrtSlices(const std::string& sequence, const DPSlice& initialSlice, size_t numSlices, size_t samplingFrequency, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	//stores a checkpoint every samplingFrequency slices, and also every slice's full scores until they'd go over memoryBudget
+	//without storeCheckpoints only the per-slice bookkeeping is kept and the table can't be traced
+	//sequence is padded to whole slices after unpaddedLength
+	DPTable getSqrtSlices(const std::string& sequence, size_t unpaddedLength, const DPSlice& initialSlice, size_t numSlices, size_t samplingFrequency, size_t memoryBudget, bool storeCheckpoints, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
 	{
 		assert(initialSlice.j == -WordConfiguration<Word>::WordSize);
-		assert(initialSlice.j + numSlices * WordConfiguration<Word>::WordSize <= sequence.size());
+		assert((LengthType)(initialSlice.j + WordConfiguration<Word>::WordSize) + numSlices * WordConfiguration<Word>::WordSize <= sequence.size() + WordConfiguration<Word>::WordSize);
+		auto forwardStart = std::chrono::system_clock::now();
 		DPTable result;
 		size_t realCells = 0;
 		size_t cellsProcessed = 0;
 		result.samplingFrequency = samplingFrequency;
-		std::vector<bool> previousBand;
-		std::vector<bool> currentBand;
-		std::vector<size_t> partOfComponent;
-		UniqueQueue<LengthType> calculables { params.graph.NodeSize() };
-		previousBand.resize(params.graph.NodeSize(), false);
-		currentBand.resize(params.graph.NodeSize(), false);
-		partOfComponent.resize(params.graph.NodeSize(), std::numeric_limits<size_t>::max());
+		result.memoryBudget = memoryBudget;
+		bool keepFullSlices = storeCheckpoints;
+		auto& previousBand = workspace.previousBand;
+		auto& currentBand = workspace.currentBand;
+		auto& partOfComponent = workspace.partOfComponent;
+		auto& calculables = workspace.calculables;
 		{
 			auto initialOrder = initialSlice.nodes;
 			for (auto node : initialOrder)
 			{
-				previousBand[node] = true;
+				previousBand.set(node, true);
 			}
 		}
 #ifndef NDEBUG
@@ -2597,8 +3281,7 @@ private:
 		DPSlice storeSlice = lastSlice;
 		assert(lastSlice.correctness.CurrentlyCorrect());
 		DPSlice rampSlice = lastSlice;
-		std::vector<bool> processed;
-		processed.resize(params.graph.SizeInBp(), false);
+		auto& processed = workspace.processed;
 		size_t rampRedoIndex = -1;
 		size_t rampUntil = 0;
 		DPSlice backtraceOverridePreslice = lastSlice;
@@ -2617,6 +3300,7 @@ private:
 #endif
 			auto timeStart = std::chrono::system_clock::now();
 			auto newSlice = pickMethodAndExtendFill(sequence, lastSlice, previousBand, currentBand, partOfComponent, calculables, processed, nodesliceMap, bandwidth);
+			stats.slices++;
 			auto timeEnd = std::chrono::system_clock::now();
 			auto time = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count();
 #ifdef SLICEVERBOSE
@@ -2640,6 +3324,11 @@ private:
 			if (!newSlice.correctness.CorrectFromCorrect())
 			{
 				newSlice.scores.clearVectorMap();
+				for (auto node : newSlice.nodes)
+				{
+					assert(currentBand[node]);
+					currentBand.set(node, false);
+				}
 #ifndef NDEBUG
 				debugLastProcessedSlice = slice-1;
 #endif
@@ -2650,24 +3339,32 @@ private:
 				for (auto node : newSlice.nodes)
 				{
 					assert(currentBand[node]);
-					currentBand[node] = false;
+					currentBand.set(node, false);
 				}
 				for (auto node : lastSlice.nodes)
 				{
 					assert(previousBand[node]);
-					previousBand[node] = false;
+					previousBand.set(node, false);
 				}
 				newSlice.scores.clearVectorMap();
+				stats.rampEvents++;
 				rampUntil = slice;
 				std::swap(slice, rampRedoIndex);
 				std::swap(lastSlice, rampSlice);
 				for (auto node : lastSlice.nodes)
 				{
 					assert(!previousBand[node]);
-					previousBand[node] = true;
+					previousBand.set(node, true);
 				}
 				while (result.bandwidthPerSlice.size() > slice+1) result.bandwidthPerSlice.pop_back();
 				while (result.correctness.size() > slice+1) result.correctness.pop_back();
+				while (result.fullSlices.size() > slice+1)
+				{
+					result.fullSlicesMemory -= result.fullSlices.back().StoredMemoryUsage();
+					result.fullSlices.pop_back();
+				}
+				while (result.memoryPerSlice.size() > slice+1) result.memoryPerSlice.pop_back();
+				while (result.minScorePerSlice.size() > slice+1) result.minScorePerSlice.pop_back();
 				while (result.slices.size() > 1 && result.slices.back().j > slice * WordConfiguration<Word>::WordSize) result.slices.pop_back();
 #ifdef SLICEVERBOSE
 				std::cerr << " ramp to " << slice;
@@ -2696,8 +3393,7 @@ private:
 #endif
 						while (backtraceOverrideTemps.size() > 0 && backtraceOverrideTemps.back().j > lastSlice.j)
 						{
-							DPSlice tmp;
-							std::swap(backtraceOverrideTemps.back(), tmp);
+							backtraceOverrideTemps.pop_back();
 						}
 #ifdef SLICEVERBOSE
 						std::cerr << " to " << backtraceOverrideTemps.size() << " temps";
@@ -2718,7 +3414,7 @@ private:
 				continue;
 			}
 
-			if (!backtraceOverriding && newSlice.numCells >= params.BacktraceOverrideCutoff && lastSlice.numCells < params.BacktraceOverrideCutoff)
+			if (storeCheckpoints && !backtraceOverriding && newSlice.numCells >= params.BacktraceOverrideCutoff && lastSlice.numCells < params.BacktraceOverrideCutoff)
 			{
 #ifdef SLICEVERBOSE
 				std::cerr << " start backtrace override";
@@ -2726,7 +3422,7 @@ private:
 				assert(lastSlice.numCells < params.BacktraceOverrideCutoff);
 				backtraceOverridePreslice = lastSlice;
 				backtraceOverriding = true;
-				backtraceOverrideTemps.push_back(newSlice.getFrozenScores());
+				backtraceOverrideTemps.push_back(newSlice.getCompressedScores());
 			}
 			else if (backtraceOverriding)
 			{
@@ -2737,13 +3433,13 @@ private:
 #endif
 					assert(lastSlice.j == backtraceOverrideTemps.back().j);
 					assert(backtraceOverrideTemps.size() > 0);
-					result.backtraceOverrides.emplace_back(params, sequence, backtraceOverridePreslice, backtraceOverrideTemps);
+					addBacktraceOverride(result, sequence, backtraceOverridePreslice, backtraceOverrideTemps);
 					backtraceOverriding = false;
 					while (result.slices.size() > 0 && result.slices.back().j >= result.backtraceOverrides.back().startj && result.slices.back().j <= result.backtraceOverrides.back().endj)
 					{
 						result.slices.pop_back();
 					}
-					result.slices.push_back(lastSlice);
+					addCheckpoint(result, lastSlice);
 #ifdef SLICEVERBOSE
 					std::cerr << " push slice j " << lastSlice.j;
 #endif
@@ -2759,7 +3455,7 @@ private:
 #ifdef SLICEVERBOSE
 					std::cerr << " continue backtrace override";
 #endif
-					backtraceOverrideTemps.push_back(newSlice.getFrozenScores());
+					backtraceOverrideTemps.push_back(newSlice.getCompressedScores());
 				}
 			}
 #ifdef SLICEVERBOSE
@@ -2769,27 +3465,67 @@ private:
 			assert(result.bandwidthPerSlice.size() == slice);
 			result.bandwidthPerSlice.push_back(bandwidth);
 			result.correctness.push_back(newSlice.correctness);
-			if (slice % samplingFrequency == 0)
+			if (newSlice.j + WordConfiguration<Word>::WordSize > unpaddedLength)
+			{
+				result.minScorePerSlice.push_back(minScoreAtRow(newSlice, unpaddedLength - 1 - newSlice.j));
+			}
+			else
+			{
+				result.minScorePerSlice.emplace_back(newSlice.minScore, newSlice.minScoreIndex.back());
+			}
+			if (backtraceOverriding)
+			{
+				//the backtrace override has these
+				result.memoryPerSlice.push_back(0);
+			}
+			else
+			{
+				result.memoryPerSlice.push_back(newSlice.EstimatedMemoryUsage());
+			}
+			DPSlice compressedSlice;
+			if (keepFullSlices && !backtraceOverriding)
+			{
+				compressedSlice = newSlice.getCompressedScores();
+				stats.checkpointRawBytes += newSlice.scores.FrozenScoresMemoryUsage();
+				stats.checkpointCompressedBytes += compressedSlice.scores.MemoryUsage();
+			}
+			if (keepFullSlices && result.fullSlicesMemory + compressedSlice.StoredMemoryUsage() > memoryBudget)
+			{
+				keepFullSlices = false;
+				result.fullSlicesMemory = 0;
+				//empty memory
+				{
+					decltype(result.fullSlices) tmp;
+					std::swap(result.fullSlices, tmp);
+				}
+			}
+			if (keepFullSlices)
+			{
+				assert(result.fullSlices.size() == slice);
+				result.fullSlicesMemory += compressedSlice.StoredMemoryUsage();
+				result.fullSlices.push_back(std::move(compressedSlice));
+			}
+			if (storeCheckpoints && slice % samplingFrequency == 0)
 			{
 				if (result.slices.size() == 0 || storeSlice.j != result.slices.back().j)
 				{
-					result.slices.push_back(storeSlice);
+					addCheckpoint(result, storeSlice);
 #ifdef SLICEVERBOSE
 					std::cerr << " push slice j " << storeSlice.j;
 #endif
 					storeSlice = newSlice.getFrozenSqrtEndScores();
 				}
 			}
-			if (newSlice.EstimatedMemoryUsage() < storeSlice.EstimatedMemoryUsage())
+			if (storeCheckpoints && newSlice.EstimatedMemoryUsage() < storeSlice.EstimatedMemoryUsage())
 			{
 				storeSlice = newSlice.getFrozenSqrtEndScores();
 			}
 			for (auto node : lastSlice.nodes)
 			{
 				assert(previousBand[node]);
-				previousBand[node] = false;
+				previousBand.set(node, false);
 			}
-			assert(newSlice.minScore != std::numeric_limits<LengthType>::max());
+			assert(newSlice.minScore != std::numeric_limits<ScoreType>::max());
 			assert(newSlice.minScore >= lastSlice.minScore);
 #ifndef NDEBUG
 			for (auto index : newSlice.minScoreIndex)
@@ -2806,12 +3542,18 @@ private:
 			newSlice.scores.clearVectorMap();
 			std::swap(previousBand, currentBand);
 		}
+		//leave the workspace clean for the next call
+		for (auto node : lastSlice.nodes)
+		{
+			assert(previousBand[node]);
+			previousBand.set(node, false);
+		}
 
 		if (backtraceOverriding)
 		{
 			assert(backtraceOverrideTemps.size() > 0);
 			assert(lastSlice.j == backtraceOverrideTemps.back().j);
-			result.backtraceOverrides.emplace_back(params, sequence, backtraceOverridePreslice, backtraceOverrideTemps);
+			addBacktraceOverride(result, sequence, backtraceOverridePreslice, backtraceOverrideTemps);
 			backtraceOverriding = false;
 			//empty memory
 			{
@@ -2832,7 +3574,7 @@ private:
 		// result.slices = storeSlices;
 		assert(result.bandwidthPerSlice.size() == debugLastProcessedSlice + 1);
 #ifndef NDEBUG
-		assert(result.slices.size() > 0);
+		assert(!storeCheckpoints || result.slices.size() > 0);
 		for (size_t i = 0; i < result.slices.size(); i++)
 		{
 			// assert(i == 0 || result.slices[i].j / WordConfiguration<Word>::WordSize / samplingFrequency == i-1);
@@ -2852,36 +3594,69 @@ private:
 			assert(result.backtraceOverrides[i].startj > result.backtraceOverrides[i-1].endj);
 		}
 #endif
+		result.cellsProcessed = cellsProcessed;
+		if (storeCheckpoints && !keepFullSlices) stats.checkpointPolicy = std::max(stats.checkpointPolicy, AlignmentResult::SqrtCheckpoints);
+		stats.backtraceOverrides += result.backtraceOverrides.size();
+		auto forwardEnd = std::chrono::system_clock::now();
+		stats.forwardMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(forwardEnd - forwardStart).count();
 		return result;
 	}
 
-	std::vector<DPSlice> getSlicesFromTable(const std::string& sequence, LengthType overrideLastJ, const DPTable& table, size_t startIndex, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	std::pair<ScoreType, LengthType> minScoreAtRow(const DPSlice& slice, int row) const
+	{
+		assert(row >= 0);
+		assert(row < WordConfiguration<Word>::WordSize);
+		std::pair<ScoreType, LengthType> result { std::numeric_limits<ScoreType>::max(), 0 };
+		for (auto node : slice.nodes)
+		{
+			const auto nodeSlice = slice.scores.node(node);
+			for (size_t i = 0; i < nodeSlice.size(); i++)
+			{
+				auto value = nodeSlice[i].getValue(row);
+				if (value < result.first) result = std::make_pair(value, params.graph.NodeStart(node) + i);
+			}
+		}
+		return result;
+	}
+
+	//the sqrt checkpoints are stored compressed and decompressed when the backtrace reaches them
+	void addCheckpoint(DPTable& table, const DPSlice& slice) const
+	{
+		table.slices.push_back(slice.getCompressedSqrtEndScores());
+		stats.checkpointRawBytes += slice.scores.MemoryUsage();
+		stats.checkpointCompressedBytes += table.slices.back().scores.MemoryUsage();
+	}
+
+	void addBacktraceOverride(DPTable& table, const std::string& sequence, const DPSlice& preslice, const std::vector<DPSlice>& temps) const
+	{
+		size_t tempsMemory = 0;
+		for (const auto& slice : temps)
+		{
+			tempsMemory += slice.StoredMemoryUsage();
+		}
+		table.backtraceOverrides.emplace_back(params, sequence, preslice, temps);
+		stats.backtraceOverridePeakBytes = std::max(stats.backtraceOverridePeakBytes, tempsMemory + table.backtraceOverrides.back().PeakMemoryUsage());
+	}
+
+	//recalculates slices [startSlice, endSlice) from initialSlice, the slice before startSlice
+	//returns their full scores, or only the last one's end scores if keepAll is false
+	std::vector<DPSlice> getSlicesFromTable(const std::string& sequence, const DPTable& table, const DPSlice& initialSlice, size_t startSlice, size_t endSlice, bool keepAll, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
 	{
-		assert(startIndex < table.slices.size());
-		size_t startSlice = (table.slices[startIndex].j + WordConfiguration<Word>::WordSize) / WordConfiguration<Word>::WordSize;
-		assert(overrideLastJ > startSlice * WordConfiguration<Word>::WordSize);
-		size_t endSlice;
-		if (startIndex == table.slices.size()-1) endSlice = table.bandwidthPerSlice.size(); else endSlice = (table.slices[startIndex+1].j + WordConfiguration<Word>::WordSize) / WordConfiguration<Word>::WordSize;
-		if (endSlice * WordConfiguration<Word>::WordSize >= overrideLastJ) endSlice = (overrideLastJ / WordConfiguration<Word>::WordSize);
 		assert(endSlice > startSlice);
 		assert(endSlice <= table.bandwidthPerSlice.size());
-		assert(startIndex < table.slices.size());
-		const auto& initialSlice = table.slices[startIndex];
+		assert(initialSlice.j + WordConfiguration<Word>::WordSize == startSlice * WordConfiguration<Word>::WordSize);
 		std::vector<DPSlice> result;
 		size_t realCells = 0;
 		size_t cellsProcessed = 0;
-		std::vector<bool> previousBand;
-		std::vector<bool> currentBand;
-		std::vector<size_t> partOfComponent;
-		UniqueQueue<LengthType> calculables { params.graph.NodeSize() };
-		previousBand.resize(params.graph.NodeSize(), false);
-		currentBand.resize(params.graph.NodeSize(), false);
-		partOfComponent.resize(params.graph.NodeSize(), std::numeric_limits<size_t>::max());
+		auto& previousBand = workspace.previousBand;
+		auto& currentBand = workspace.currentBand;
+		auto& partOfComponent = workspace.partOfComponent;
+		auto& calculables = workspace.calculables;
 		{
 			auto initialOrder = initialSlice.nodes;
 			for (auto node : initialOrder)
 			{
-				previousBand[node] = true;
+				previousBand.set(node, true);
 			}
 		}
 #ifndef NDEBUG
@@ -2890,8 +3665,7 @@ private:
 		DPSlice lastSlice = initialSlice.getFrozenSqrtEndScores();
 		// assert(lastSlice.correctness.CurrentlyCorrect());
 		DPSlice rampSlice = lastSlice;
-		std::vector<bool> processed;
-		processed.resize(params.graph.SizeInBp(), false);
+		auto& processed = workspace.processed;
 		for (size_t slice = startSlice; slice < endSlice; slice++)
 		{
 			int bandwidth = table.bandwidthPerSlice[slice];
@@ -2899,7 +3673,7 @@ private:
 			debugLastRowMinScore = lastSlice.minScore;
 #endif
 			auto newSlice = pickMethodAndExtendFill(sequence, lastSlice, previousBand, currentBand, partOfComponent, calculables, processed, nodesliceMap, bandwidth);
-			assert(result.size() == 0 || newSlice.j == result.back().j + WordConfiguration<Word>::WordSize);
+			assert(newSlice.j == lastSlice.j + WordConfiguration<Word>::WordSize);
 
 			size_t sliceCells = 0;
 			for (auto node : newSlice.nodes)
@@ -2910,13 +3684,13 @@ private:
 			cellsProcessed += newSlice.cellsProcessed;
 
 			// assert(slice == endSlice-1 || newSlice.correctness.CurrentlyCorrect());
-			result.push_back(newSlice.getFrozenScores());
+			if (keepAll) result.push_back(newSlice.getFrozenScores());
 			for (auto node : lastSlice.nodes)
 			{
 				assert(previousBand[node]);
-				previousBand[node] = false;
+				previousBand.set(node, false);
 			}
-			assert(newSlice.minScore != std::numeric_limits<LengthType>::max());
+			assert(newSlice.minScore != std::numeric_limits<ScoreType>::max());
 			assert(newSlice.minScore >= lastSlice.minScore);
 #ifndef NDEBUG
 			for (auto index : newSlice.minScoreIndex)
@@ -2933,6 +3707,13 @@ private:
 			newSlice.scores.clearVectorMap();
 			std::swap(previousBand, currentBand);
 		}
+		//leave the workspace clean for the next call
+		for (auto node : lastSlice.nodes)
+		{
+			assert(previousBand[node]);
+			previousBand.set(node, false);
+		}
+		if (!keepAll) result.push_back(std::move(lastSlice));
 #ifndef NDEBUG
 		for (size_t i = 1; i < result.size(); i++)
 		{
@@ -2963,10 +3744,12 @@ private:
 	{
 		size_t samplingFrequency = 1;
 		samplingFrequency = (int)(sqrt(sequenceLen / WordConfiguration<Word>::WordSize));
+		//the backtrace needs at least every other slice sampled, short parts next to a seed near the read end would get 1
+		if (samplingFrequency < 2) samplingFrequency = 2;
 		return samplingFrequency;
 	}
 
-	TwoDirectionalSplitAlignment getSplitAlignment(const std::string& sequence, LengthType matchBigraphNodeId, bool matchBigraphNodeBackwards, LengthType matchSequencePosition, ScoreType maxScore, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	TwoDirectionalSplitAlignment getSplitAlignment(const std::string& sequence, LengthType matchBigraphNodeId, bool matchBigraphNodeBackwards, LengthType matchSequencePosition, ScoreType maxScore, bool storeCheckpoints, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
 	{
 		assert(matchSequencePosition >= 0);
 		assert(matchSequencePosition < sequence.size());
@@ -2998,7 +3781,7 @@ private:
 			}
 			auto backwardInitialBand = getInitialSliceOnlyOneNode(backwardNode);
 			size_t samplingFrequency = getSamplingFrequency(backwardPart.size());
-			auto backwardSlice = getSqrtSlices(backwardPart, backwardInitialBand, backwardPart.size() / WordConfiguration<Word>::WordSize, samplingFrequency, nodesliceMap);
+			auto backwardSlice = getSqrtSlices(backwardPart, backwardPart.size() - backwardpadding, backwardInitialBand, backwardPart.size() / WordConfiguration<Word>::WordSize, samplingFrequency, params.checkpointMemoryBudget, storeCheckpoints, nodesliceMap);
 			removeWronglyAlignedEnd(backwardSlice);
 			result.backward = std::move(backwardSlice);
 			if (result.backward.slices.size() > 0) score += result.backward.slices.back().minScore;
@@ -3014,7 +3797,9 @@ private:
 			}
 			auto forwardInitialBand = getInitialSliceOnlyOneNode(forwardNode);
 			size_t samplingFrequency = getSamplingFrequency(forwardPart.size());
-			auto forwardSlice = getSqrtSlices(forwardPart, forwardInitialBand, forwardPart.size() / WordConfiguration<Word>::WordSize, samplingFrequency, nodesliceMap);
+			//the backward table's full slices use part of the budget until both are traced
+			size_t memoryBudget = params.checkpointMemoryBudget - std::min(params.checkpointMemoryBudget, result.backward.fullSlicesMemory);
+			auto forwardSlice = getSqrtSlices(forwardPart, forwardPart.size() - forwardpadding, forwardInitialBand, forwardPart.size() / WordConfiguration<Word>::WordSize, samplingFrequency, memoryBudget, storeCheckpoints, nodesliceMap);
 			removeWronglyAlignedEnd(forwardSlice);
 			result.forward = std::move(forwardSlice);
 			if (result.forward.slices.size() > 0) score += result.forward.slices.back().minScore;
@@ -3036,7 +3821,7 @@ private:
 		return trace;
 	}
 
-	std::pair<std::tuple<ScoreType, std::vector<MatrixPosition>>, std::tuple<ScoreType, std::vector<MatrixPosition>>> getPiecewiseTracesFromSplit(const TwoDirectionalSplitAlignment& split, const std::string& sequence, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	std::pair<std::tuple<ScoreType, std::vector<MatrixPosition>>, std::tuple<ScoreType, std::vector<MatrixPosition>>> getPiecewiseTracesFromSplit(const TwoDirectionalSplitAlignment& split, const std::string& sequence, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
 	{
 		assert(split.sequenceSplitIndex >= 0);
 		assert(split.sequenceSplitIndex < sequence.size());
@@ -3097,7 +3882,7 @@ private:
 		return std::make_pair(backtraceresult, reverseBacktraceResult);
 	}
 
-	std::tuple<ScoreType, std::vector<MatrixPosition>, size_t> getBacktraceFullStart(std::string sequence, std::vector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
+	std::tuple<ScoreType, std::vector<MatrixPosition>, size_t> getBacktraceFullStart(std::string sequence, EpochVector<typename NodeSlice<WordSlice>::MapItem>& nodesliceMap) const
 	{
 		int padding = (WordConfiguration<Word>::WordSize - (sequence.size() % WordConfiguration<Word>::WordSize)) % WordConfiguration<Word>::WordSize;
 		for (int i = 0; i < padding; i++)
@@ -3118,7 +3903,7 @@ private:
 			}
 		}
 		size_t samplingFrequency = getSamplingFrequency(sequence.size());
-		auto slice = getSqrtSlices(sequence, startSlice, sequence.size() / WordConfiguration<Word>::WordSize, samplingFrequency, nodesliceMap);
+		auto slice = getSqrtSlices(sequence, sequence.size() - padding, startSlice, sequence.size() / WordConfiguration<Word>::WordSize, samplingFrequency, params.checkpointMemoryBudget, true, nodesliceMap);
 		removeWronglyAlignedEnd(slice);
 		// std::cerr << "score: " << slice.slices.back().minScore << std::endl;
 
@@ -3129,7 +3914,7 @@ private:
 		}
 		assert(backtraceresult.second[0].second == 0);
 		assert(backtraceresult.second.back().second == sequence.size() - padding - 1);
-		return std::make_tuple(backtraceresult.first, backtraceresult.second, 0);
+		return std::make_tuple(backtraceresult.first, backtraceresult.second, slice.cellsProcessed);
 	}
 
 };
@@ -0,0 +1,332 @@
+#ifndef GraphAlignerBatch_h
+#define GraphAlignerBatch_h
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include "AlignmentGraph.h"
+#include "WordSlice.h"
+#include "GraphAligner.h"
+#include "GraphAlignerWrapper.h"
+#include "GraphAlignerWorkspace.h"
+#include "ThreadReadAssertion.h"
+
+//edit distances of up to Lanes reads against the whole graph, without a band and without a backtrace.
+//every read is one lane and all lanes go through the same bitvector operations,
+//so the compiler can keep the lanes of a column in one vector register.
+//the read can start and end anywhere in the graph, like the full band start of GraphAligner,
+//but every row covers the whole graph so the cost is graph size * longest read / 64 per batch.
+//this is not a batched GraphAligner: the banded aligner's bands, ramps and backtraces are per read
+//so it still aligns one read at a time. this only gives the score and the end position,
+//which is useful for short reads against small graphs
+//the caller's target attribute decides the vector width, see GraphAlignerWrapper.cpp
+template <typename LengthType, typename ScoreType, int Lanes>
+class GraphAlignerBatch
+{
+	using Word = uint64_t;
+	using Slice = WordSlice<LengthType, ScoreType, Word>;
+	typedef GraphAlignerBatchWorkspace<ScoreType> Workspace;
+	static constexpr int WordSize = WordConfiguration<Word>::WordSize;
+public:
+	GraphAlignerBatch(const AlignmentGraph& graph, Workspace& workspace) :
+	graph(graph),
+	workspace(workspace)
+	{
+		assert(workspace.lanes == Lanes);
+	}
+
+	__attribute__((always_inline)) std::vector<FullBandScore> AlignBatch(const std::vector<const std::string*>& sequences) const
+	{
+		assert(sequences.size() > 0);
+		assert(sequences.size() <= Lanes);
+		size_t maxLength = 0;
+		for (auto sequence : sequences)
+		{
+			assert(sequence->size() > 0);
+			maxLength = std::max(maxLength, sequence->size());
+		}
+		bool cyclic = false;
+		auto order = nodeOrder(cyclic);
+		ScoreType bestScore[Lanes];
+		LengthType bestPosition[Lanes];
+		for (int lane = 0; lane < Lanes; lane++)
+		{
+			bestScore[lane] = std::numeric_limits<ScoreType>::max();
+			bestPosition[lane] = 0;
+		}
+		//the row before the first one is all zeros so the read can start anywhere
+		std::fill(workspace.previousRow.begin(), workspace.previousRow.end(), 0);
+		for (size_t j = 0; j < maxLength; j += WordSize)
+		{
+			//indexed by GraphAligner::baseMask of the graph base, so ambiguous graph bases have their Eq too
+			Word Eqs[16][Lanes];
+			//row in these 64 rows where the lane's read ends, or -1
+			int endRow[Lanes];
+			bool anyEnds = false;
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				endRow[lane] = -1;
+				for (int c = 0; c < 16; c++)
+				{
+					Eqs[c][lane] = WordConfiguration<Word>::AllZeros;
+				}
+				if ((size_t)lane >= sequences.size()) continue;
+				const std::string& sequence = *sequences[lane];
+				if (sequence.size() > j && sequence.size() <= j + WordSize)
+				{
+					endRow[lane] = sequence.size() - 1 - j;
+					anyEnds = true;
+				}
+				for (int i = 0; i < WordSize && j+i < sequence.size(); i++)
+				{
+					Word mask = ((Word)1) << i;
+					for (int c = 0; c < 4; c++)
+					{
+						if (GraphAligner<LengthType, ScoreType, Word>::characterMatch(sequence[j+i], "ATCG"[c])) Eqs[1 << c][lane] |= mask;
+					}
+				}
+				//a combination of bases matches where any of them matches
+				for (int c = 1; c < 16; c++)
+				{
+					Eqs[c][lane] = Eqs[c & -c][lane] | Eqs[c & (c - 1)][lane];
+				}
+			}
+			workspace.epoch++;
+			//cycles are iterated until the last columns of the nodes don't change
+			//without cycles the nodes are in topological order and one pass is enough
+			bool changed = true;
+			while (changed)
+			{
+				changed = false;
+				for (auto node : order)
+				{
+					if (anyEnds)
+					{
+						changed = alignNode<true>(node, j, Eqs, endRow, bestScore, bestPosition) || changed;
+					}
+					else
+					{
+						changed = alignNode<false>(node, j, Eqs, endRow, bestScore, bestPosition) || changed;
+					}
+				}
+				if (!cyclic) break;
+			}
+			std::swap(workspace.previousRow, workspace.currentRow);
+		}
+		std::vector<FullBandScore> result;
+		for (size_t lane = 0; lane < sequences.size(); lane++)
+		{
+			FullBandScore score;
+			score.score = bestScore[lane];
+			auto node = graph.IndexToNode(bestPosition[lane]);
+			score.endNodeId = graph.nodeIDs[node] / 2;
+			score.endOffset = bestPosition[lane] - graph.NodeStart(node);
+			score.endReverse = graph.reverse[node];
+			result.push_back(score);
+		}
+		return result;
+	}
+
+private:
+
+	//nodes in topological order, followed by the nodes in cycles
+	std::vector<LengthType> nodeOrder(bool& cyclic) const
+	{
+		std::vector<LengthType> result;
+		std::vector<size_t> inDegree;
+		inDegree.resize(graph.NodeSize(), 0);
+		std::vector<LengthType> stack;
+		//skip the dummy start and end nodes
+		for (size_t i = 1; i < graph.NodeSize() - 1; i++)
+		{
+			inDegree[i] = graph.inNeighbors[i].size();
+			if (inDegree[i] == 0) stack.push_back(i);
+		}
+		while (stack.size() > 0)
+		{
+			auto node = stack.back();
+			stack.pop_back();
+			result.push_back(node);
+			for (auto neighbor : graph.outNeighbors[node])
+			{
+				assert(inDegree[neighbor] > 0);
+				inDegree[neighbor]--;
+				if (inDegree[neighbor] == 0) stack.push_back(neighbor);
+			}
+		}
+		cyclic = result.size() < graph.NodeSize() - 2;
+		for (size_t i = 1; i < graph.NodeSize() - 1; i++)
+		{
+			if (inDegree[i] > 0) result.push_back(i);
+		}
+		return result;
+	}
+
+	//the next column of every lane, see GraphAligner::getNextSlice
+	//hin is the horizontal difference in the row before the first row, -1, 0 or 1
+	//hout is the horizontal difference in the last row
+	__attribute__((always_inline)) static void nextColumn(const Word* Eq, Word* VP, Word* VN, const ScoreType* hin, ScoreType* hout)
+	{
+		for (int lane = 0; lane < Lanes; lane++)
+		{
+			Word negative = -(Word)(hin[lane] < 0);
+			Word positive = -(Word)(hin[lane] > 0);
+			Word eq = Eq[lane];
+			Word Xv = eq | VN[lane];
+			eq |= negative & 1;
+			Word Xh = (((eq & VP[lane]) + VP[lane]) ^ VP[lane]) | eq;
+			Word Ph = VN[lane] | ~(Xh | VP[lane]);
+			Word Mh = VP[lane] & Xh;
+			hout[lane] = (ScoreType)(Ph >> (WordSize - 1)) - (ScoreType)(Mh >> (WordSize - 1));
+			Ph = (Ph << 1) | (positive & 1);
+			Mh = (Mh << 1) | (negative & 1);
+			VP[lane] = Mh | ~(Xv | Ph);
+			VN[lane] = Ph & Xv;
+		}
+	}
+
+	__attribute__((always_inline)) static void updateBest(LengthType position, const Word* VP, const Word* VN, const ScoreType* scoreBefore, const int* endRow, ScoreType* bestScore, LengthType* bestPosition)
+	{
+		for (int lane = 0; lane < Lanes; lane++)
+		{
+			if (endRow[lane] == -1) continue;
+			Word mask = WordConfiguration<Word>::AllOnes;
+			if (endRow[lane] < WordSize - 1) mask = ~(WordConfiguration<Word>::AllOnes << (endRow[lane] + 1));
+			ScoreType score = scoreBefore[lane] + WordConfiguration<Word>::popcount(VP[lane] & mask) - WordConfiguration<Word>::popcount(VN[lane] & mask);
+			if (score < bestScore[lane])
+			{
+				bestScore[lane] = score;
+				bestPosition[lane] = position;
+			}
+		}
+	}
+
+	//returns whether the last column of the node changed
+	template <bool UpdateBest>
+	__attribute__((always_inline)) bool alignNode(LengthType node, size_t j, const Word (&Eqs)[16][Lanes], const int (&endRow)[Lanes], ScoreType* bestScore, LengthType* bestPosition) const
+	{
+		const ScoreType* previous = workspace.previousRow.data();
+		ScoreType* current = workspace.currentRow.data();
+		auto start = graph.NodeStart(node);
+		auto end = graph.NodeEnd(node);
+		Word VP[Lanes];
+		Word VN[Lanes];
+		ScoreType score[Lanes];
+		ScoreType hin[Lanes];
+		ScoreType hout[Lanes];
+		//the bases are read 32 at a time as 2-bit codes unless the node has ambiguous bases
+		const bool packedBases = !graph.NodeHasAmbiguousBases(node);
+		uint64_t codes = packedBases ? graph.NodeSequenceCodes(start) : 0;
+		const Word* Eq = packedBases ? Eqs[1 << (codes & 3)] : Eqs[GraphAligner<LengthType, ScoreType, Word>::baseMask(graph.NodeSequences(start))];
+		auto neighbors = graph.inNeighbors[node];
+		if (neighbors.size() == 1 && workspace.endComputed[*neighbors.begin()] == workspace.epoch)
+		{
+			//with one in-neighbor the horizontal difference is always -1, 0 or 1
+			auto neighbor = *neighbors.begin();
+			auto neighborEnd = graph.NodeEnd(neighbor) - 1;
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				VP[lane] = workspace.endVP[neighbor * Lanes + lane];
+				VN[lane] = workspace.endVN[neighbor * Lanes + lane];
+				hin[lane] = previous[start * Lanes + lane] - previous[neighborEnd * Lanes + lane];
+			}
+			nextColumn(Eq, VP, VN, hin, hout);
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				score[lane] = current[neighborEnd * Lanes + lane] + hout[lane];
+			}
+		}
+		else
+		{
+			//minimum of the column coming from above and the columns from each in-neighbor.
+			//the in-neighbor columns start one above the in-neighbor's score so hin is 1,
+			//which is never less than the real score and keeps the difference in range.
+			//a source node has a virtual in-neighbor whose score is row+1 so the read can start at the node.
+			Slice merged[Lanes];
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				merged[lane] = Slice { WordConfiguration<Word>::AllOnes, WordConfiguration<Word>::AllZeros, previous[start * Lanes + lane] + WordSize, previous[start * Lanes + lane], WordSize, false };
+				hin[lane] = 1;
+			}
+			if (neighbors.size() == 0)
+			{
+				for (int lane = 0; lane < Lanes; lane++)
+				{
+					VP[lane] = WordConfiguration<Word>::AllOnes;
+					VN[lane] = WordConfiguration<Word>::AllZeros;
+				}
+				nextColumn(Eq, VP, VN, hin, hout);
+				for (int lane = 0; lane < Lanes; lane++)
+				{
+					merged[lane] = merged[lane].mergeWith(Slice { VP[lane], VN[lane], (ScoreType)(j + WordSize) + hout[lane], (ScoreType)j + 1, WordSize, false });
+				}
+			}
+			for (auto neighbor : neighbors)
+			{
+				//not calculated yet in a cycle, the next pass will use it
+				if (workspace.endComputed[neighbor] != workspace.epoch) continue;
+				auto neighborEnd = graph.NodeEnd(neighbor) - 1;
+				for (int lane = 0; lane < Lanes; lane++)
+				{
+					VP[lane] = workspace.endVP[neighbor * Lanes + lane];
+					VN[lane] = workspace.endVN[neighbor * Lanes + lane];
+				}
+				nextColumn(Eq, VP, VN, hin, hout);
+				for (int lane = 0; lane < Lanes; lane++)
+				{
+					merged[lane] = merged[lane].mergeWith(Slice { VP[lane], VN[lane], current[neighborEnd * Lanes + lane] + hout[lane], previous[neighborEnd * Lanes + lane] + 1, WordSize, false });
+				}
+			}
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				assert(merged[lane].scoreBeforeStart == previous[start * Lanes + lane]);
+				VP[lane] = merged[lane].VP;
+				VN[lane] = merged[lane].VN;
+				score[lane] = merged[lane].scoreEnd;
+			}
+		}
+		for (int lane = 0; lane < Lanes; lane++)
+		{
+			current[start * Lanes + lane] = score[lane];
+		}
+		if (UpdateBest) updateBest(start, VP, VN, previous + start * Lanes, endRow, bestScore, bestPosition);
+		for (LengthType w = start + 1; w < end; w++)
+		{
+			if (packedBases)
+			{
+				if ((w - start) % 32 == 0) codes = graph.NodeSequenceCodes(w); else codes >>= 2;
+				Eq = Eqs[1 << (codes & 3)];
+			}
+			else
+			{
+				Eq = Eqs[GraphAligner<LengthType, ScoreType, Word>::baseMask(graph.NodeSequences(w))];
+			}
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				hin[lane] = previous[w * Lanes + lane] - previous[(w - 1) * Lanes + lane];
+			}
+			nextColumn(Eq, VP, VN, hin, hout);
+			for (int lane = 0; lane < Lanes; lane++)
+			{
+				score[lane] += hout[lane];
+				current[w * Lanes + lane] = score[lane];
+			}
+			if (UpdateBest) updateBest(w, VP, VN, previous + w * Lanes, endRow, bestScore, bestPosition);
+		}
+		bool changed = workspace.endComputed[node] != workspace.epoch;
+		workspace.endComputed[node] = workspace.epoch;
+		for (int lane = 0; lane < Lanes; lane++)
+		{
+			changed = changed || workspace.endVP[node * Lanes + lane] != VP[lane] || workspace.endVN[node * Lanes + lane] != VN[lane];
+			workspace.endVP[node * Lanes + lane] = VP[lane];
+			workspace.endVN[node * Lanes + lane] = VN[lane];
+		}
+		return changed;
+	}
+
+	const AlignmentGraph& graph;
+	Workspace& workspace;
+};
+
+#endif
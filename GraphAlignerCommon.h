@@ -13,15 +13,28 @@ public:
 	//and this way they don't need to be recalculated, saving about half of the time.
 	//must be the same as AlternateMethodCutoff because of cell existance etc.
 	static constexpr size_t BacktraceOverrideCutoff = AlternateMethodCutoff;
-	GraphAlignerParams(LengthType initialBandwidth, LengthType rampBandwidth, const AlignmentGraph& graph) :
+	//band size in bp above which the band's components are split over the workspace's component pool, if it has one
+	//smaller bands are done before the tasks would get to another thread
+	static constexpr size_t ParallelComponentCutoff = 20000;
+	static constexpr size_t DefaultCheckpointMemoryBudget = (size_t)1024 * 1024 * 1024;
+	static constexpr double DefaultSeedStopFraction = 1.0;
+	GraphAlignerParams(LengthType initialBandwidth, LengthType rampBandwidth, const AlignmentGraph& graph, size_t checkpointMemoryBudget = DefaultCheckpointMemoryBudget, double seedStopFraction = DefaultSeedStopFraction) :
 	initialBandwidth(initialBandwidth),
 	rampBandwidth(rampBandwidth),
-	graph(graph)
+	graph(graph),
+	checkpointMemoryBudget(checkpointMemoryBudget),
+	seedStopFraction(seedStopFraction)
 	{
 	}
 	const LengthType initialBandwidth;
 	const LengthType rampBandwidth;
 	const AlignmentGraph& graph;
+	//bytes of stored DP slices one alignment may use. the backtrace recalculates nothing if all slices fit,
+	//otherwise it recalculates from sqrt(slices) checkpoints, or splits the recalculated parts further if those don't fit either
+	const size_t checkpointMemoryBudget;
+	//a seed isn't extended if the best alignment of the earlier seeds is at least this fraction of the most the seed could align.
+	//1 skips only the seeds which can't give a better alignment, lower values skip more, 0 extends every seed
+	const double seedStopFraction;
 };
 
 #endif
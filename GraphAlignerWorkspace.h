@@ -0,0 +1,126 @@
+#ifndef GraphAlignerWorkspace_h
+#define GraphAlignerWorkspace_h
+
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "AlignmentGraph.h"
+#include "UniqueQueue.h"
+#include "EpochVector.h"
+#include "ThreadReadAssertion.h"
+#include "ComponentThreadPool.h"
+
+//buffers sized to the graph which one thread reuses for all of its reads
+//so the setup cost of a read doesn't depend on the size of the graph.
+//the aligner leaves them cleared when it returns normally.
+//an alignment that throws (eg. an assertion failure) leaves them dirty, and they're reset on the next acquire.
+//the graph sized ones are epoch stamped so the reset doesn't depend on the size of the graph either
+template <typename LengthType>
+class GraphAlignerWorkspace
+{
+public:
+	//same as NodeSlice::MapItem
+	using MapItem = std::tuple<size_t, size_t, int>;
+	GraphAlignerWorkspace(const AlignmentGraph& graph, ComponentThreadPool* componentPool = nullptr) :
+	nodesliceMap(graph.NodeSize(), MapItem { 0, 0, 0 }),
+	previousBand(graph.NodeSize()),
+	currentBand(graph.NodeSize()),
+	partOfComponent(graph.NodeSize(), std::numeric_limits<size_t>::max()),
+	processed(graph.SizeInBp()),
+	calculables(graph.NodeSize()),
+	projectionDistances(graph.NodeSize(), std::make_pair((size_t)0, (size_t)0)),
+	projectionBuckets(),
+	projectionEpoch(0),
+	indexInComponent(),
+	componentPool(componentPool),
+	dirty(false)
+	{
+	}
+	void acquire()
+	{
+		if (dirty) reset();
+#ifdef EXTRACORRECTNESSASSERTIONS
+		assertClean();
+#endif
+		dirty = true;
+	}
+	void release()
+	{
+		dirty = false;
+	}
+	EpochVector<MapItem> nodesliceMap;
+	EpochBitVector previousBand;
+	EpochBitVector currentBand;
+	EpochVector<size_t> partOfComponent;
+	EpochBitVector processed;
+	UniqueQueue<LengthType> calculables;
+	//band projection: epoch and distance per node, the distance is only valid if the epoch is the current projection's.
+	//the queue has one bucket per distance. neither needs clearing between reads
+	std::vector<std::pair<size_t, size_t>> projectionDistances;
+	std::vector<std::vector<LengthType>> projectionBuckets;
+	size_t projectionEpoch;
+	//position of a node in its strongly connected component when the components are calculated in parallel
+	//sized on first use. always written before it's read so it doesn't need to be cleared
+	std::vector<LengthType> indexInComponent;
+	//calculate independent components of a slice on these threads, or everything on the calling thread if null
+	ComponentThreadPool* componentPool;
+private:
+	void reset()
+	{
+		nodesliceMap.clear();
+		previousBand.clear();
+		currentBand.clear();
+		partOfComponent.clear();
+		processed.clear();
+		calculables.clear();
+	}
+#ifdef EXTRACORRECTNESSASSERTIONS
+	void assertClean() const
+	{
+		for (size_t i = 0; i < nodesliceMap.size(); i++)
+		{
+			assert(std::get<0>(nodesliceMap[i]) == std::get<1>(nodesliceMap[i]));
+			assert(!previousBand[i]);
+			assert(!currentBand[i]);
+			assert(partOfComponent[i] == std::numeric_limits<size_t>::max());
+		}
+		for (size_t i = 0; i < processed.size(); i++)
+		{
+			assert(!processed[i]);
+		}
+		assert(calculables.size() == 0);
+	}
+#endif
+	bool dirty;
+};
+
+//buffers sized to the graph for GraphAlignerBatch, one per thread
+//the lanes are next to each other, eg. previousRow[column * lanes + lane]
+template <typename ScoreType>
+class GraphAlignerBatchWorkspace
+{
+public:
+	GraphAlignerBatchWorkspace(const AlignmentGraph& graph, int lanes) :
+	lanes(lanes),
+	previousRow(graph.SizeInBp() * lanes, 0),
+	currentRow(graph.SizeInBp() * lanes, 0),
+	endVP(graph.NodeSize() * lanes, 0),
+	endVN(graph.NodeSize() * lanes, 0),
+	endComputed(graph.NodeSize(), 0),
+	epoch(0)
+	{
+	}
+	const int lanes;
+	//scores at the last row of the previous and the current 64 rows
+	std::vector<ScoreType> previousRow;
+	std::vector<ScoreType> currentRow;
+	//bitvectors of the last column of each node in the current 64 rows
+	std::vector<uint64_t> endVP;
+	std::vector<uint64_t> endVN;
+	//the last column of a node has been calculated in the current 64 rows if endComputed[node] == epoch
+	std::vector<size_t> endComputed;
+	size_t epoch;
+};
+
+#endif
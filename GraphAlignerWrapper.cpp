@@ -1,19 +1,200 @@
 //split this here so modifying GraphAligner.h doesn't require recompiling every cpp file
 
 #include "GraphAlignerWrapper.h"
+#include <algorithm>
+#include <limits>
 #include "GraphAligner.h"
+#include "GraphAlignerBatch.h"
 #include "ThreadReadAssertion.h"
 
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart)
+//each DP slice covers one word of read rows. per slice costs (band projection, components, checkpoints)
+//dominate on long reads, so long reads use wider words and fewer slices.
+//256 rows (MultiLimbWord<4>) is slower than 128 even on 250kbp reads so 128 is the widest
+const size_t WideWordReadLength = 50000;
+
+int AlignmentWordSize(size_t readLength)
+{
+	if (readLength >= WideWordReadLength) return 128;
+	return 64;
+}
+
+//positions in the DP are graph offsets and read rows. 32 bits halves the band's node lists, the traces and
+//the stored slices when both fit, with room left over for the sentinels at the maximum value
+const size_t CompactPositionLimit = std::numeric_limits<uint32_t>::max() / 2;
+
+int AlignmentPositionBits(const AlignmentGraph& graph, size_t readLength)
+{
+	if (graph.SizeInBp() < CompactPositionLimit && readLength < CompactPositionLimit) return 32;
+	return 64;
+}
+
+AlignerWorkspace::AlignerWorkspace(const AlignmentGraph& graph, ComponentThreadPool* componentPool) :
+graph(graph),
+componentPool(componentPool),
+compact(),
+wide()
+{
+}
+
+GraphAlignerWorkspace<uint32_t>& AlignerWorkspace::Compact()
+{
+	if (compact == nullptr) compact.reset(new GraphAlignerWorkspace<uint32_t> { graph, componentPool });
+	return *compact;
+}
+
+GraphAlignerWorkspace<size_t>& AlignerWorkspace::Wide()
+{
+	if (wide == nullptr) wide.reset(new GraphAlignerWorkspace<size_t> { graph, componentPool });
+	return *wide;
+}
+
+template <typename LengthType>
+GraphAlignerWorkspace<LengthType>& workspaceFor(AlignerWorkspace& workspace);
+
+template <>
+GraphAlignerWorkspace<uint32_t>& workspaceFor<uint32_t>(AlignerWorkspace& workspace)
+{
+	return workspace.Compact();
+}
+
+template <>
+GraphAlignerWorkspace<size_t>& workspaceFor<size_t>(AlignerWorkspace& workspace)
+{
+	return workspace.Wide();
+}
+
+template <typename LengthType, typename Word, typename... SeedHits>
+AlignmentResult alignOneWayWithTypes(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, size_t checkpointMemoryBudget, double seedStopFraction, AlignerWorkspace& workspace, const SeedHits&... seedHits)
+{
+	GraphAlignerParams<LengthType, int32_t, Word> params {(LengthType)initialBandwidth, (LengthType)rampBandwidth, graph, checkpointMemoryBudget, seedStopFraction};
+	auto& typedWorkspace = workspaceFor<LengthType>(workspace);
+	typedWorkspace.acquire();
+	GraphAligner<LengthType, int32_t, Word> aligner {params, typedWorkspace};
+	auto result = aligner.AlignOneWay(seq_id, sequence, dynamicRowStart, seedHits...);
+	typedWorkspace.release();
+	return result;
+}
+
+template <typename LengthType, typename... SeedHits>
+AlignmentResult alignOneWayWithLength(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, size_t checkpointMemoryBudget, double seedStopFraction, AlignerWorkspace& workspace, const SeedHits&... seedHits)
+{
+	switch(AlignmentWordSize(sequence.size()))
+	{
+		case 128:
+			return alignOneWayWithTypes<LengthType, __uint128_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, dynamicRowStart, checkpointMemoryBudget, seedStopFraction, workspace, seedHits...);
+		default:
+			return alignOneWayWithTypes<LengthType, uint64_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, dynamicRowStart, checkpointMemoryBudget, seedStopFraction, workspace, seedHits...);
+	}
+}
+
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, size_t checkpointMemoryBudget, AlignerWorkspace& workspace)
+{
+	//no seeds to skip
+	if (AlignmentPositionBits(graph, sequence.size()) == 32) return alignOneWayWithLength<uint32_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, dynamicRowStart, checkpointMemoryBudget, 0, workspace);
+	return alignOneWayWithLength<size_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, dynamicRowStart, checkpointMemoryBudget, 0, workspace);
+}
+
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, size_t checkpointMemoryBudget, double seedStopFraction, const std::vector<std::tuple<int, size_t, bool>>& seedHits, AlignerWorkspace& workspace)
+{
+	if (AlignmentPositionBits(graph, sequence.size()) == 32) return alignOneWayWithLength<uint32_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, dynamicRowStart, checkpointMemoryBudget, seedStopFraction, workspace, seedHits);
+	return alignOneWayWithLength<size_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, dynamicRowStart, checkpointMemoryBudget, seedStopFraction, workspace, seedHits);
+}
+
+template <typename LengthType, typename Word>
+AlignmentResult alignScoreOnlyWithTypes(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, double seedStopFraction, const std::vector<std::tuple<int, size_t, bool>>& seedHits, AlignerWorkspace& workspace)
+{
+	//no checkpoints are stored
+	GraphAlignerParams<LengthType, int32_t, Word> params {(LengthType)initialBandwidth, (LengthType)rampBandwidth, graph, 0, seedStopFraction};
+	auto& typedWorkspace = workspaceFor<LengthType>(workspace);
+	typedWorkspace.acquire();
+	GraphAligner<LengthType, int32_t, Word> aligner {params, typedWorkspace};
+	auto result = aligner.AlignOneWayScoreOnly(seq_id, sequence, seedHits);
+	typedWorkspace.release();
+	return result;
+}
+
+template <typename LengthType>
+AlignmentResult alignScoreOnlyWithLength(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, double seedStopFraction, const std::vector<std::tuple<int, size_t, bool>>& seedHits, AlignerWorkspace& workspace)
+{
+	switch(AlignmentWordSize(sequence.size()))
+	{
+		case 128:
+			return alignScoreOnlyWithTypes<LengthType, __uint128_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, seedStopFraction, seedHits, workspace);
+		default:
+			return alignScoreOnlyWithTypes<LengthType, uint64_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, seedStopFraction, seedHits, workspace);
+	}
+}
+
+AlignmentResult AlignOneWayScoreOnly(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, double seedStopFraction, const std::vector<std::tuple<int, size_t, bool>>& seedHits, AlignerWorkspace& workspace)
+{
+	if (AlignmentPositionBits(graph, sequence.size()) == 32) return alignScoreOnlyWithLength<uint32_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, seedStopFraction, seedHits, workspace);
+	return alignScoreOnlyWithLength<size_t>(graph, seq_id, sequence, initialBandwidth, rampBandwidth, seedStopFraction, seedHits, workspace);
+}
+
+//one function per vector width. the batch aligner is inlined into them so it's compiled for that instruction set
+//and only called if the CPU supports it
+__attribute__((target("avx512f"))) std::vector<FullBandScore> scoreFullBandAVX512(const AlignmentGraph& graph, const std::vector<const std::string*>& sequences, FullBandWorkspace& workspace)
+{
+	GraphAlignerBatch<size_t, int32_t, 8> aligner { graph, workspace };
+	return aligner.AlignBatch(sequences);
+}
+
+__attribute__((target("avx2"))) std::vector<FullBandScore> scoreFullBandAVX2(const AlignmentGraph& graph, const std::vector<const std::string*>& sequences, FullBandWorkspace& workspace)
+{
+	GraphAlignerBatch<size_t, int32_t, 4> aligner { graph, workspace };
+	return aligner.AlignBatch(sequences);
+}
+
+std::vector<FullBandScore> scoreFullBandSSE2(const AlignmentGraph& graph, const std::vector<const std::string*>& sequences, FullBandWorkspace& workspace)
+{
+	GraphAlignerBatch<size_t, int32_t, 2> aligner { graph, workspace };
+	return aligner.AlignBatch(sequences);
+}
+
+int FullBandLanes()
 {
-	GraphAlignerParams<size_t, int32_t, uint64_t> params {initialBandwidth, rampBandwidth, graph};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	return aligner.AlignOneWay(seq_id, sequence, dynamicRowStart);
+	if (__builtin_cpu_supports("avx512f")) return 8;
+	if (__builtin_cpu_supports("avx2")) return 4;
+	return 2;
 }
 
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, const std::vector<std::tuple<int, size_t, bool>>& seedHits)
+std::vector<FullBandScore> ScoreFullBand(const AlignmentGraph& graph, const std::vector<std::string>& sequences, FullBandWorkspace& workspace)
 {
-	GraphAlignerParams<size_t, int32_t, uint64_t> params {initialBandwidth, rampBandwidth, graph};
-	GraphAligner<size_t, int32_t, uint64_t> aligner {params};
-	return aligner.AlignOneWay(seq_id, sequence, dynamicRowStart, seedHits);
+	std::vector<FullBandScore> result;
+	result.resize(sequences.size(), FullBandScore { 0, 0, 0, false });
+	//reads of about the same length in the same batch so the lanes finish at about the same row
+	std::vector<size_t> order;
+	for (size_t i = 0; i < sequences.size(); i++)
+	{
+		if (sequences[i].size() > 0) order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&sequences](size_t left, size_t right) { return sequences[left].size() > sequences[right].size(); });
+	for (size_t i = 0; i < order.size(); i += workspace.lanes)
+	{
+		std::vector<const std::string*> batch;
+		for (size_t j = i; j < order.size() && j < i + workspace.lanes; j++)
+		{
+			batch.push_back(&sequences[order[j]]);
+		}
+		std::vector<FullBandScore> batchResult;
+		switch(workspace.lanes)
+		{
+			case 8:
+				batchResult = scoreFullBandAVX512(graph, batch, workspace);
+				break;
+			case 4:
+				batchResult = scoreFullBandAVX2(graph, batch, workspace);
+				break;
+			case 2:
+				batchResult = scoreFullBandSSE2(graph, batch, workspace);
+				break;
+			default:
+				assert(false);
+		}
+		for (size_t j = 0; j < batchResult.size(); j++)
+		{
+			result[order[i+j]] = batchResult[j];
+		}
+	}
+	return result;
 }
@@ -3,8 +3,10 @@
 #ifndef GraphAlignerWrapper_h
 #define GraphAlignerWrapper_h
 
+#include <memory>
 #include <tuple>
 #include "AlignmentGraph.h"
+#include "GraphAlignerWorkspace.h"
 #include "vg.pb.h"
 
 class AlignmentResult
@@ -29,6 +31,81 @@ public:
 		char graphChar;
 		char readChar;
 	};
+	//how the DP slices were stored for the backtrace, from least to most recalculation
+	enum CheckpointPolicy
+	{
+		//every slice, nothing is recalculated
+		AllCheckpoints = 0,
+		//every sqrt(slices)th slice, the slices between are recalculated once
+		SqrtCheckpoints = 1,
+		//the recalculated parts didn't fit in memory and were split recursively
+		RecursiveCheckpoints = 2,
+		//score-only alignment, nothing was stored and there's no backtrace
+		NoCheckpoints = 3
+	};
+	struct GraphPosition
+	{
+		//original node id like in the output alignments
+		int nodeID;
+		size_t offset;
+		bool reverse;
+	};
+	//per-read counters and phase times for the metrics file
+	struct AlignmentStats
+	{
+		AlignmentStats() :
+		seedsTried(0),
+		seedChains(0),
+		seedsSkipped(0),
+		slices(0),
+		bitvectorSlices(0),
+		alternateSlices(0),
+		parallelSlices(0),
+		projectedNodes(0),
+		rampEvents(0),
+		backtraceOverrides(0),
+		backtraceOverridePeakBytes(0),
+		checkpointPolicy(AllCheckpoints),
+		checkpointRawBytes(0),
+		checkpointCompressedBytes(0),
+		checkpointDecodeMicroseconds(0),
+		forwardMicroseconds(0),
+		backtraceMicroseconds(0),
+		outputMicroseconds(0)
+		{
+		}
+		size_t seedsTried;
+		//colinear chains of the read's seeds, one seed per chain is extended
+		size_t seedChains;
+		//seeds not extended because of seedStopFraction
+		size_t seedsSkipped;
+		//slices of the forward DP, including ones redone after a ramp
+		size_t slices;
+		//these include the slices recomputed during the backtrace
+		size_t bitvectorSlices;
+		size_t alternateSlices;
+		//bitvector slices whose components were split over the component pool
+		size_t parallelSlices;
+		//queue entries handled by the band projections, summed over the slices
+		size_t projectedNodes;
+		size_t rampEvents;
+		size_t backtraceOverrides;
+		//the most memory one backtrace override used while it was built, including its compressed input slices
+		size_t backtraceOverridePeakBytes;
+		//the most recalculation any part of the read needed
+		CheckpointPolicy checkpointPolicy;
+		//bytes of the kept full slices and sqrt checkpoints as frozen scores and compressed
+		size_t checkpointRawBytes;
+		size_t checkpointCompressedBytes;
+		//decompressing the full slices and checkpoints during the backtrace, part of backtraceMicroseconds
+		size_t checkpointDecodeMicroseconds;
+		//getSqrtSlices
+		size_t forwardMicroseconds;
+		//getTraceFromTable
+		size_t backtraceMicroseconds;
+		//trace to alignment conversion and merging
+		size_t outputMicroseconds;
+	};
 	AlignmentResult()
 	{
 	}
@@ -38,7 +115,9 @@ public:
 	cellsProcessed(cellsProcessed),
 	elapsedMilliseconds(ms),
 	alignmentStart(0),
-	alignmentEnd(0)
+	alignmentEnd(0),
+	startPosition { 0, 0, false },
+	endPosition { 0, 0, false }
 	{
 	}
 	vg::Alignment alignment;
@@ -47,10 +126,57 @@ public:
 	size_t elapsedMilliseconds;
 	size_t alignmentStart;
 	size_t alignmentEnd;
+	//only set by AlignOneWayScoreOnly, whose alignment has a score but no path.
+	//a cell with the minimum score at the first and last aligned base of the read, ties may differ from the backtrace
+	GraphPosition startPosition;
+	GraphPosition endPosition;
 	std::vector<TraceItem> trace;
+	AlignmentStats stats;
 };
 
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart);
-AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, const std::vector<std::tuple<int, size_t, bool>>& seedHits);
+//one per thread, reused for all of the thread's alignments
+//there's a separate set of buffers for each position width, made when it's first used
+//with a component pool, wide bands of a read are split over the pool's threads
+class AlignerWorkspace
+{
+public:
+	AlignerWorkspace(const AlignmentGraph& graph, ComponentThreadPool* componentPool = nullptr);
+	GraphAlignerWorkspace<uint32_t>& Compact();
+	GraphAlignerWorkspace<size_t>& Wide();
+private:
+	const AlignmentGraph& graph;
+	ComponentThreadPool* componentPool;
+	std::unique_ptr<GraphAlignerWorkspace<uint32_t>> compact;
+	std::unique_ptr<GraphAlignerWorkspace<size_t>> wide;
+};
+
+//rows per DP slice (64 or 128), picked by AlignOneWay from the read length
+int AlignmentWordSize(size_t readLength);
+//bits per graph and read position in the DP (32 or 64), picked by AlignOneWay from the graph size and the read length
+int AlignmentPositionBits(const AlignmentGraph& graph, size_t readLength);
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, size_t checkpointMemoryBudget, AlignerWorkspace& workspace);
+AlignmentResult AlignOneWay(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, size_t dynamicRowStart, size_t checkpointMemoryBudget, double seedStopFraction, const std::vector<std::tuple<int, size_t, bool>>& seedHits, AlignerWorkspace& workspace);
+//only the forward pass of AlignOneWay, without checkpoints or a backtrace. the result has the score,
+//the estimated correctly aligned part of the read and the start and end positions, but no path
+AlignmentResult AlignOneWayScoreOnly(const AlignmentGraph& graph, const std::string& seq_id, const std::string& sequence, int initialBandwidth, int rampBandwidth, double seedStopFraction, const std::vector<std::tuple<int, size_t, bool>>& seedHits, AlignerWorkspace& workspace);
+
+//edit distance of a read to the whole graph without a band, and where the best alignment ends.
+//costs graph size * read length, so it's only for short reads against small graphs
+class FullBandScore
+{
+public:
+	int score;
+	//original node id like in the output alignments
+	int endNodeId;
+	size_t endOffset;
+	bool endReverse;
+};
+
+typedef GraphAlignerBatchWorkspace<int32_t> FullBandWorkspace;
+
+//number of reads scored at once in the lanes of a vector register, picked from the CPU's features
+int FullBandLanes();
+//the workspace must have FullBandLanes() lanes. one result per read in the same order
+std::vector<FullBandScore> ScoreFullBand(const AlignmentGraph& graph, const std::vector<std::string>& sequences, FullBandWorkspace& workspace);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef IndexFormat_h
+#define IndexFormat_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "FlatArray.h"
+
+//binary index files: header, then scalars and arrays in an order decided by the caller
+//each array is its element count followed by the elements, padded to a multiple of 8 bytes
+//the checksum is the crc32 of everything after the header
+//files are loaded with mmap and the arrays are used in place
+namespace IndexFormat
+{
+	//detects files written on a machine with a different byte order
+	const uint64_t ByteOrderMark = 0x0102030405060708;
+	struct Header
+	{
+		char magic[8];
+		uint64_t version;
+		uint64_t byteOrderMark;
+		uint64_t checksum;
+	};
+
+	inline uLong Checksum(uLong checksum, const char* data, size_t size)
+	{
+		while (size > 0)
+		{
+			uInt chunk = std::min(size, (size_t)std::numeric_limits<uInt>::max());
+			checksum = crc32(checksum, (const Bytef*)data, chunk);
+			data += chunk;
+			size -= chunk;
+		}
+		return checksum;
+	}
+
+	class Writer
+	{
+	public:
+		Writer(std::string filename, const char* magic, uint64_t version) :
+		filename(filename),
+		out(filename, std::ios::out | std::ios::binary),
+		checksum(crc32(0, Z_NULL, 0))
+		{
+			memcpy(header.magic, magic, sizeof(header.magic));
+			header.version = version;
+			header.byteOrderMark = ByteOrderMark;
+			header.checksum = 0;
+			out.write((const char*)&header, sizeof(header));
+		}
+		void write(const void* data, size_t size)
+		{
+			out.write((const char*)data, size);
+			checksum = Checksum(checksum, (const char*)data, size);
+		}
+		void scalar(uint64_t value)
+		{
+			write(&value, sizeof(value));
+		}
+		template <typename T>
+		void array(const FlatArray<T>& values)
+		{
+			scalar(values.size());
+			write(values.data(), values.size() * sizeof(T));
+			const char padding[8] {};
+			if (values.size() * sizeof(T) % 8 != 0) write(padding, 8 - values.size() * sizeof(T) % 8);
+		}
+		void finish()
+		{
+			header.checksum = checksum;
+			out.seekp(0);
+			out.write((const char*)&header, sizeof(header));
+			out.close();
+			if (!out.good())
+			{
+				std::cerr << "Could not write index to " << filename << std::endl;
+				std::exit(0);
+			}
+		}
+	private:
+		std::string filename;
+		std::ofstream out;
+		Header header;
+		uLong checksum;
+	};
+
+	class Reader
+	{
+	public:
+		//maps the file and checks the header and the checksum, exits on error
+		Reader(std::string filename, const char* magic, uint64_t version) :
+		filename(filename),
+		mapped(),
+		size(0),
+		pos(sizeof(Header))
+		{
+			int fd = open(filename.c_str(), O_RDONLY);
+			if (fd == -1)
+			{
+				std::cerr << "Could not open index " << filename << std::endl;
+				std::exit(0);
+			}
+			struct stat filestat;
+			fstat(fd, &filestat);
+			size = filestat.st_size;
+			if (size < sizeof(Header))
+			{
+				std::cerr << "Index " << filename << " is truncated" << std::endl;
+				std::exit(0);
+			}
+			//shared read-only mapping so concurrent jobs on the same index share the pages
+			void* ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (ptr == MAP_FAILED)
+			{
+				std::cerr << "Could not mmap index " << filename << std::endl;
+				std::exit(0);
+			}
+			size_t mappedSize = size;
+			mapped = std::shared_ptr<const char> { (const char*)ptr, [mappedSize](const char* p) { munmap((void*)p, mappedSize); } };
+			Header header;
+			memcpy(&header, mapped.get(), sizeof(header));
+			if (memcmp(header.magic, magic, sizeof(header.magic)) != 0)
+			{
+				std::cerr << filename << " is not a " << magic << " index" << std::endl;
+				std::exit(0);
+			}
+			if (header.version != version || header.byteOrderMark != ByteOrderMark)
+			{
+				std::cerr << "Index " << filename << " was built by an incompatible version (" << header.version << "), rebuild the index" << std::endl;
+				std::exit(0);
+			}
+			if (Checksum(crc32(0, Z_NULL, 0), mapped.get() + sizeof(Header), size - sizeof(Header)) != header.checksum)
+			{
+				std::cerr << "Index " << filename << " is corrupted (checksum mismatch)" << std::endl;
+				std::exit(0);
+			}
+		}
+		void scalar(uint64_t& value)
+		{
+			if (size - pos < sizeof(value)) truncated();
+			memcpy(&value, mapped.get() + pos, sizeof(value));
+			pos += sizeof(value);
+		}
+		template <typename T>
+		void array(FlatArray<T>& values)
+		{
+			uint64_t count;
+			scalar(count);
+			if (count > (size - pos) / sizeof(T)) truncated();
+			values.map((const T*)(mapped.get() + pos), count);
+			pos += (count * sizeof(T) + 7) / 8 * 8;
+			if (pos > size) truncated();
+		}
+		//the arrays point into the mapping, keep this alive as long as they are used
+		std::shared_ptr<const char> mapping() const
+		{
+			return mapped;
+		}
+	private:
+		void truncated() const
+		{
+			std::cerr << "Index " << filename << " is truncated" << std::endl;
+			std::exit(0);
+		}
+		std::string filename;
+		std::shared_ptr<const char> mapped;
+		size_t size;
+		size_t pos;
+	};
+}
+
+#endif
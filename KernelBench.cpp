@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "vg.pb.h"
+#include "BigraphToDigraph.h"
+#include "AlignmentGraph.h"
+#include "GraphAligner.h"
+#include "ThreadReadAssertion.h"
+
+//microbenchmarks of the DP kernels on fixed inputs, without the banding, ramping and backtrace around them
+//each scenario computes a fixed number of rows over a fixed set of nodes, starting from a zero row like the full band start
+//everything uses a fixed random seed so runs of different versions compute the same cells
+
+const int Bandwidth = 10;
+const double SubstitutionRate = 0.03;
+
+std::mt19937 generator { 42 };
+
+size_t randomInt(size_t min, size_t max)
+{
+	return std::uniform_int_distribution<size_t>(min, max)(generator);
+}
+
+std::string randomSequence(size_t length)
+{
+	std::string result;
+	result.reserve(length);
+	for (size_t i = 0; i < length; i++)
+	{
+		result += "ACGT"[randomInt(0, 3)];
+	}
+	return result;
+}
+
+int addNode(vg::Graph& graph, const std::string& sequence)
+{
+	auto node = graph.add_node();
+	node->set_id(graph.node_size());
+	node->set_sequence(sequence);
+	return node->id();
+}
+
+void addEdge(vg::Graph& graph, int from, int to)
+{
+	auto edge = graph.add_edge();
+	edge->set_from(from);
+	edge->set_to(to);
+}
+
+//a read of the given length from a random walk of the forward strand starting at the first node, with substitutions
+std::string walkSequence(const vg::Graph& graph, size_t length)
+{
+	std::vector<std::vector<int>> outEdges;
+	outEdges.resize(graph.node_size()+1);
+	for (int i = 0; i < graph.edge_size(); i++)
+	{
+		outEdges[graph.edge(i).from()].push_back(graph.edge(i).to());
+	}
+	std::string result;
+	int current = 1;
+	while (result.size() < length)
+	{
+		result += graph.node(current-1).sequence();
+		if (outEdges[current].size() == 0) break;
+		current = outEdges[current][randomInt(0, outEdges[current].size()-1)];
+	}
+	while (result.size() < length) result += randomSequence(1);
+	result.resize(length);
+	for (size_t i = 0; i < result.size(); i++)
+	{
+		if (randomInt(0, 999) < SubstitutionRate * 1000) result[i] = "ACGT"[randomInt(0, 3)];
+	}
+	return result;
+}
+
+//one long node
+vg::Graph singleNodeGraph(size_t length)
+{
+	vg::Graph result;
+	addNode(result, randomSequence(length));
+	return result;
+}
+
+//hubs joined by many short alternative nodes, so every hub has a high in-degree
+vg::Graph highInDegreeGraph(size_t hubs, size_t degree)
+{
+	vg::Graph result;
+	int last = addNode(result, randomSequence(32));
+	for (size_t i = 0; i < hubs; i++)
+	{
+		int hub = addNode(result, randomSequence(32));
+		for (size_t j = 0; j < degree; j++)
+		{
+			int alternative = addNode(result, randomSequence(8));
+			addEdge(result, last, alternative);
+			addEdge(result, alternative, hub);
+		}
+		last = hub;
+	}
+	return result;
+}
+
+//an entry node and a ring of short nodes, so the band is one strongly connected component
+vg::Graph cycleGraph(size_t ringSize, size_t nodeLength)
+{
+	vg::Graph result;
+	int entry = addNode(result, randomSequence(nodeLength));
+	int first = addNode(result, randomSequence(nodeLength));
+	addEdge(result, entry, first);
+	int last = first;
+	for (size_t i = 1; i < ringSize; i++)
+	{
+		int node = addNode(result, randomSequence(nodeLength));
+		addEdge(result, last, node);
+		last = node;
+	}
+	addEdge(result, last, first);
+	return result;
+}
+
+//SNP bubbles, sized so the forward strand is just under the bitvector/alternate cutoff
+vg::Graph wideGraph(size_t size)
+{
+	vg::Graph result;
+	int last = addNode(result, randomSequence(32));
+	size_t length = 32;
+	while (length + 34 < size)
+	{
+		int allele = addNode(result, randomSequence(1));
+		int otherAllele = addNode(result, randomSequence(1));
+		int node = addNode(result, randomSequence(32));
+		addEdge(result, last, allele);
+		addEdge(result, last, otherAllele);
+		addEdge(result, allele, node);
+		addEdge(result, otherAllele, node);
+		length += 34;
+		last = node;
+	}
+	return result;
+}
+
+class GraphAlignerKernelBenchmark
+{
+	using Aligner = GraphAligner<size_t, int32_t, uint64_t>;
+	using Word = uint64_t;
+	using DPSlice = Aligner::DPSlice;
+	using EqVector = Aligner::EqVector;
+	using WordSlice = Aligner::WordSlice;
+public:
+	struct KernelResult
+	{
+		KernelResult() : nanoseconds(0), cells(0), nodes(0) {}
+		size_t nanoseconds;
+		size_t cells;
+		size_t nodes;
+	};
+	enum Kernel
+	{
+		CalculateNode,
+		CalculateSlice,
+		CalculateSliceAlternate
+	};
+	GraphAlignerKernelBenchmark(const AlignmentGraph& graph) :
+	graph(graph),
+	params(Bandwidth, 0, graph),
+	workspace(graph),
+	aligner(params, workspace)
+	{
+		for (size_t i = 1; i < graph.NodeSize() - 1; i++)
+		{
+			//forward nodes are added before their reverse complements
+			if (graph.GetReverseNode(i) > i) forwardNodes.push_back(i);
+		}
+	}
+	//rows of the given kernel over all forward nodes, band projection is measured from each bitvector row
+	std::pair<KernelResult, KernelResult> run(Kernel kernel, const std::string& sequence)
+	{
+		KernelResult result;
+		KernelResult projection;
+		workspace.acquire();
+		auto& previousBand = workspace.previousBand;
+		auto& currentBand = workspace.currentBand;
+		DPSlice previous = startSlice();
+		for (auto node : previous.nodes)
+		{
+			previousBand.set(node, true);
+		}
+		for (size_t j = 0; j < sequence.size(); j += WordConfiguration<Word>::WordSize)
+		{
+			DPSlice current { &workspace.nodesliceMap };
+			current.j = j;
+			current.correctness = previous.correctness;
+			auto timeStart = std::chrono::high_resolution_clock::now();
+			if (kernel == CalculateSliceAlternate)
+			{
+				current.scores.reserve(params.AlternateMethodCutoff);
+				timeStart = std::chrono::high_resolution_clock::now();
+				auto sliceResult = aligner.calculateSliceAlternate(sequence, current.j, current.scores, previous, workspace.processed, Bandwidth);
+				result.nanoseconds += nanosecondsSince(timeStart);
+				current.cellsProcessed = sliceResult.cellsProcessed;
+				current.minScore = sliceResult.minScore;
+				current.minScoreIndex = sliceResult.minScoreIndex;
+				current.correctness = current.correctness.NextState(current.minScore - previous.minScore, WordConfiguration<Word>::WordSize);
+				aligner.finalizeAlternateSlice(current, currentBand, sequence.size(), Bandwidth);
+			}
+			else
+			{
+				current.nodes = forwardNodes;
+				for (auto node : current.nodes)
+				{
+					current.scores.addNode(node, graph.NodeLength(node));
+					currentBand.set(node, true);
+				}
+				if (kernel == CalculateNode)
+				{
+					assert(current.nodes.size() == 1);
+					auto EqV = eqVector(sequence, j);
+					timeStart = std::chrono::high_resolution_clock::now();
+					auto nodeResult = aligner.calculateNode(current.nodes[0], current.j, sequence, EqV, current.scores, previous.scores, currentBand, previousBand);
+					result.nanoseconds += nanosecondsSince(timeStart);
+					current.scores.setMinScore(current.nodes[0], nodeResult.minScore);
+					current.cellsProcessed = nodeResult.cellsProcessed;
+					current.minScore = nodeResult.minScore;
+					current.minScoreIndex = nodeResult.minScoreIndex;
+					current.correctness = current.correctness.NextState(current.minScore - previous.minScore, WordConfiguration<Word>::WordSize);
+				}
+				else
+				{
+					timeStart = std::chrono::high_resolution_clock::now();
+					aligner.fillDPSlice(sequence, current, previous, previousBand, workspace.partOfComponent, currentBand, workspace.calculables);
+					result.nanoseconds += nanosecondsSince(timeStart);
+				}
+				current.numCells = current.cellsProcessed;
+				timeStart = std::chrono::high_resolution_clock::now();
+				auto projected = aligner.projectForwardFromMinScore(current.minScore, current, currentBand, Bandwidth);
+				projection.nanoseconds += nanosecondsSince(timeStart);
+				projection.nodes += projected.size();
+			}
+			result.cells += current.cellsProcessed;
+			result.nodes += current.nodes.size();
+			for (auto node : previous.nodes)
+			{
+				previousBand.set(node, false);
+			}
+			previous = current.getFrozenSqrtEndScores();
+			current.scores.clearVectorMap();
+			std::swap(previousBand, currentBand);
+		}
+		for (auto node : previous.nodes)
+		{
+			previousBand.set(node, false);
+		}
+		workspace.release();
+		return std::make_pair(result, projection);
+	}
+	//getNextSlice chained along a row without a band above it, eg. the first row of a node
+	KernelResult nextSlice(size_t iterations)
+	{
+		KernelResult result;
+		WordSlice slice { WordConfiguration<Word>::AllOnes, WordConfiguration<Word>::AllZeros, WordConfiguration<Word>::WordSize, 0, 0, false };
+		WordSlice previous = slice;
+		std::vector<Word> Eqs;
+		for (size_t i = 0; i < 1024; i++)
+		{
+			Eqs.push_back(((Word)generator() << 32) ^ generator());
+		}
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		for (size_t i = 0; i < iterations; i++)
+		{
+			slice = aligner.getNextSlice(Eqs[i % Eqs.size()], slice, false, false, false, false, previous);
+		}
+		result.nanoseconds = nanosecondsSince(timeStart);
+		result.cells = iterations * WordConfiguration<Word>::WordSize;
+		result.nodes = 0;
+		//keep the loop from being optimized away
+		if (slice.scoreEnd == -1) std::cerr << "";
+		return result;
+	}
+private:
+	static size_t nanosecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+	//same as in calculateSlice
+	EqVector eqVector(const std::string& sequence, size_t j) const
+	{
+		Word BA = WordConfiguration<Word>::AllZeros;
+		Word BT = WordConfiguration<Word>::AllZeros;
+		Word BC = WordConfiguration<Word>::AllZeros;
+		Word BG = WordConfiguration<Word>::AllZeros;
+		for (int i = 0; i < WordConfiguration<Word>::WordSize && j+i < sequence.size(); i++)
+		{
+			Word mask = ((Word)1) << i;
+			if (Aligner::characterMatch(sequence[j+i], 'A')) BA |= mask;
+			if (Aligner::characterMatch(sequence[j+i], 'C')) BC |= mask;
+			if (Aligner::characterMatch(sequence[j+i], 'T')) BT |= mask;
+			if (Aligner::characterMatch(sequence[j+i], 'G')) BG |= mask;
+		}
+		return EqVector { BA, BT, BC, BG };
+	}
+	//zero row over the forward nodes, like the full band start
+	DPSlice startSlice() const
+	{
+		DPSlice result;
+		result.j = -WordConfiguration<Word>::WordSize;
+		result.minScore = 0;
+		for (auto node : forwardNodes)
+		{
+			result.scores.addNode(node, graph.NodeLength(node));
+			result.scores.setMinScore(node, 0);
+			result.nodes.push_back(node);
+			auto slice = result.scores.node(node);
+			for (size_t i = 0; i < slice.size(); i++)
+			{
+				slice[i] = {0, 0, 0, 0, WordConfiguration<Word>::WordSize, false};
+			}
+		}
+		return result;
+	}
+	const AlignmentGraph& graph;
+	GraphAlignerParams<size_t, int32_t, uint64_t> params;
+	GraphAlignerWorkspace<size_t> workspace;
+	Aligner aligner;
+	std::vector<size_t> forwardNodes;
+};
+
+//position to node lookups at random positions, like the backtrace does for each cell of the trace
+//binarySearch searches the node starts instead of using the graph's rank index, for comparison
+GraphAlignerKernelBenchmark::KernelResult positionLookup(const AlignmentGraph& graph, size_t iterations, bool binarySearch)
+{
+	GraphAlignerKernelBenchmark::KernelResult result;
+	std::vector<size_t> positions;
+	for (size_t i = 0; i < 1048576; i++)
+	{
+		positions.push_back(randomInt(0, graph.SizeInBp() - 1));
+	}
+	std::vector<size_t> nodeStarts;
+	for (size_t i = 0; i < graph.NodeSize(); i++)
+	{
+		nodeStarts.push_back(graph.NodeStart(i));
+	}
+	size_t checksum = 0;
+	auto timeStart = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		auto pos = positions[i % positions.size()];
+		if (binarySearch)
+		{
+			checksum += std::upper_bound(nodeStarts.begin(), nodeStarts.end(), pos) - nodeStarts.begin() - 1;
+		}
+		else
+		{
+			checksum += graph.IndexToNode(pos);
+		}
+	}
+	result.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - timeStart).count();
+	result.cells = iterations;
+	result.nodes = 0;
+	//keep the loop from being optimized away
+	if (checksum == 1) std::cerr << "";
+	return result;
+}
+
+void printResult(const std::string& kernel, const std::string& scenario, const GraphAlignerKernelBenchmark::KernelResult& result)
+{
+	std::cout << kernel << "\t" << scenario << "\t" << result.nodes << "\t" << result.cells << "\t" << result.nanoseconds / 1000000000.0;
+	std::cout << "\t" << (result.cells > 0 ? (double)result.nanoseconds / result.cells : 0);
+	std::cout << "\t" << (result.nodes > 0 ? (double)result.nanoseconds / result.nodes : 0) << std::endl;
+}
+
+void benchmarkScenario(const std::string& scenario, const vg::Graph& bigraph, size_t rows, bool alternate)
+{
+	auto graph = DirectedGraph::BuildFromVG(bigraph);
+	auto sequence = walkSequence(bigraph, rows * WordConfiguration<uint64_t>::WordSize);
+	GraphAlignerKernelBenchmark benchmark { graph };
+	if (bigraph.node_size() == 1)
+	{
+		auto result = benchmark.run(GraphAlignerKernelBenchmark::CalculateNode, sequence);
+		printResult("calculateNode", scenario, result.first);
+		printResult("projectForwardFromMinScore", scenario, result.second);
+	}
+	else
+	{
+		auto result = benchmark.run(GraphAlignerKernelBenchmark::CalculateSlice, sequence);
+		printResult("calculateSlice", scenario, result.first);
+		printResult("projectForwardFromMinScore", scenario, result.second);
+	}
+	if (alternate)
+	{
+		auto result = benchmark.run(GraphAlignerKernelBenchmark::CalculateSliceAlternate, sequence);
+		printResult("calculateSliceAlternate", scenario, result.first);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 2)
+	{
+		std::cerr << "usage: KernelBench [scale]" << std::endl;
+		std::cerr << "scale multiplies the number of rows of every scenario, default 1" << std::endl;
+		std::exit(0);
+	}
+	size_t scale = 1;
+	if (argc == 2) scale = std::stoi(argv[1]);
+	if (scale < 1)
+	{
+		std::cerr << "scale must be >= 1" << std::endl;
+		std::exit(0);
+	}
+	std::cout << "kernel\tscenario\tnodes\tcells\tseconds\tns/cell\tns/node" << std::endl;
+	{
+		auto graph = DirectedGraph::BuildFromVG(singleNodeGraph(64));
+		GraphAlignerKernelBenchmark benchmark { graph };
+		printResult("getNextSlice", "row", benchmark.nextSlice(10000000 * scale));
+	}
+	benchmarkScenario("single node", singleNodeGraph(16384), 64 * scale, false);
+	benchmarkScenario("high in-degree", highInDegreeGraph(64, 64), 64 * scale, false);
+	benchmarkScenario("cycle", cycleGraph(16, 16), 256 * scale, false);
+	{
+		//a few million bp so the node starts don't fit in the cache
+		auto graph = DirectedGraph::BuildFromVG(wideGraph(4000000));
+		printResult("IndexToNode", "large graph", positionLookup(graph, 10000000 * scale, false));
+		printResult("IndexToNode binary search", "large graph", positionLookup(graph, 10000000 * scale, true));
+	}
+	benchmarkScenario("wide band", wideGraph(GraphAlignerParams<size_t, int32_t, uint64_t>::AlternateMethodCutoff * 9 / 10), 8 * scale, true);
+}
@@ -0,0 +1,158 @@
+#ifndef MultiLimbWord_h
+#define MultiLimbWord_h
+
+#include <cstdint>
+
+//an unsigned integer of Limbs*64 bits which behaves like the built in unsigned types
+//for the operations the bitvector DP needs. limbs[0] is the least significant limb
+template <int Limbs>
+class MultiLimbWord
+{
+public:
+	constexpr MultiLimbWord() :
+	limbs{0}
+	{
+	}
+	constexpr MultiLimbWord(uint64_t value) :
+	limbs{value}
+	{
+	}
+	explicit constexpr operator bool() const
+	{
+		for (int i = 0; i < Limbs; i++)
+		{
+			if (limbs[i] != 0) return true;
+		}
+		return false;
+	}
+	//truncates to the lowest limb like a cast of a built in type
+	explicit constexpr operator uint64_t() const
+	{
+		return limbs[0];
+	}
+	constexpr MultiLimbWord operator~() const
+	{
+		MultiLimbWord result;
+		for (int i = 0; i < Limbs; i++)
+		{
+			result.limbs[i] = ~limbs[i];
+		}
+		return result;
+	}
+	MultiLimbWord& operator&=(const MultiLimbWord& other)
+	{
+		for (int i = 0; i < Limbs; i++)
+		{
+			limbs[i] &= other.limbs[i];
+		}
+		return *this;
+	}
+	MultiLimbWord& operator|=(const MultiLimbWord& other)
+	{
+		for (int i = 0; i < Limbs; i++)
+		{
+			limbs[i] |= other.limbs[i];
+		}
+		return *this;
+	}
+	MultiLimbWord& operator^=(const MultiLimbWord& other)
+	{
+		for (int i = 0; i < Limbs; i++)
+		{
+			limbs[i] ^= other.limbs[i];
+		}
+		return *this;
+	}
+	MultiLimbWord& operator+=(const MultiLimbWord& other)
+	{
+		//the carry out of each limb goes into the next one
+		bool carry = false;
+		for (int i = 0; i < Limbs; i++)
+		{
+			bool overflow = __builtin_add_overflow(limbs[i], other.limbs[i], &limbs[i]);
+			overflow |= __builtin_add_overflow(limbs[i], (uint64_t)carry, &limbs[i]);
+			carry = overflow;
+		}
+		return *this;
+	}
+	MultiLimbWord& operator-=(const MultiLimbWord& other)
+	{
+		bool borrow = false;
+		for (int i = 0; i < Limbs; i++)
+		{
+			bool overflow = __builtin_sub_overflow(limbs[i], other.limbs[i], &limbs[i]);
+			overflow |= __builtin_sub_overflow(limbs[i], (uint64_t)borrow, &limbs[i]);
+			borrow = overflow;
+		}
+		return *this;
+	}
+	MultiLimbWord& operator<<=(int shift)
+	{
+		int limbShift = shift / 64;
+		int bitShift = shift % 64;
+		for (int i = Limbs-1; i >= 0; i--)
+		{
+			uint64_t value = 0;
+			if (i - limbShift >= 0) value = limbs[i - limbShift] << bitShift;
+			if (bitShift > 0 && i - limbShift - 1 >= 0) value |= limbs[i - limbShift - 1] >> (64 - bitShift);
+			limbs[i] = value;
+		}
+		return *this;
+	}
+	MultiLimbWord& operator>>=(int shift)
+	{
+		int limbShift = shift / 64;
+		int bitShift = shift % 64;
+		for (int i = 0; i < Limbs; i++)
+		{
+			uint64_t value = 0;
+			if (i + limbShift < Limbs) value = limbs[i + limbShift] >> bitShift;
+			if (bitShift > 0 && i + limbShift + 1 < Limbs) value |= limbs[i + limbShift + 1] << (64 - bitShift);
+			limbs[i] = value;
+		}
+		return *this;
+	}
+	friend MultiLimbWord operator&(MultiLimbWord left, const MultiLimbWord& right)
+	{
+		return left &= right;
+	}
+	friend MultiLimbWord operator|(MultiLimbWord left, const MultiLimbWord& right)
+	{
+		return left |= right;
+	}
+	friend MultiLimbWord operator^(MultiLimbWord left, const MultiLimbWord& right)
+	{
+		return left ^= right;
+	}
+	friend MultiLimbWord operator+(MultiLimbWord left, const MultiLimbWord& right)
+	{
+		return left += right;
+	}
+	friend MultiLimbWord operator-(MultiLimbWord left, const MultiLimbWord& right)
+	{
+		return left -= right;
+	}
+	friend MultiLimbWord operator<<(MultiLimbWord left, int shift)
+	{
+		return left <<= shift;
+	}
+	friend MultiLimbWord operator>>(MultiLimbWord left, int shift)
+	{
+		return left >>= shift;
+	}
+	friend bool operator==(const MultiLimbWord& left, const MultiLimbWord& right)
+	{
+		for (int i = 0; i < Limbs; i++)
+		{
+			if (left.limbs[i] != right.limbs[i]) return false;
+		}
+		return true;
+	}
+	friend bool operator!=(const MultiLimbWord& left, const MultiLimbWord& right)
+	{
+		return !(left == right);
+	}
+	uint64_t limbs[Limbs];
+};
+
+#endif
@@ -1,10 +1,12 @@
 #ifndef NodeSlice_h
 #define NodeSlice_h
 
+#include <cstring>
 #include <limits>
 #include <unordered_map>
 #include <vector>
 #include "ThreadReadAssertion.h"
+#include "EpochVector.h"
 #include "WordSlice.h"
 
 template <typename LengthType, typename ScoreType, typename Word>
@@ -281,7 +283,8 @@ public:
 	WordContainer() :
 	minEndScore(0),
 	minStartScore(0),
-	frozen(0)
+	frozen(0),
+	compressedCount(0)
 	{
 	}
 	ContainerView getView(size_t start, size_t end, int minScore)
@@ -299,9 +302,11 @@ public:
 	}
 	const Slice operator[](size_t index) const
 	{
+		//compressed columns can only be read in order, see getDecompressedScores
+		assert(frozen != 3 && frozen != 4);
 		if (frozen == 1)
 		{
-			Slice result { frozenSlices[index].VP, frozenSlices[index].VN, 0, minStartScore + frozenSlices[index].plusMinScore, 64, false };
+			Slice result { frozenSlices[index].VP, frozenSlices[index].VN, 0, minStartScore + frozenSlices[index].plusMinScore, WordConfiguration<Word>::WordSize, false };
 			result.scoreEndExists = frozenSlices[index].scoreEndExists;
 #ifdef EXTRACORRECTNESSASSERTIONS
 			result.confirmedRows.exists = frozenSlices[index].exists;
@@ -312,10 +317,10 @@ public:
 		{
 			bool VP = frozenSqrtSlices[index].VPVNLastBit & 1;
 			bool VN = frozenSqrtSlices[index].VPVNLastBit & 2;
-			Slice result { (Word)VP << 63, (Word)VN << 63, minEndScore + frozenSqrtSlices[index].plusMinScore, minEndScore + frozenSqrtSlices[index].plusMinScore - (VP ? 1 : 0) + (VN ? 1 : 0), 64, false };
+			Slice result { ((Word)VP) << (WordConfiguration<Word>::WordSize - 1), ((Word)VN) << (WordConfiguration<Word>::WordSize - 1), minEndScore + frozenSqrtSlices[index].plusMinScore, minEndScore + frozenSqrtSlices[index].plusMinScore - (VP ? 1 : 0) + (VN ? 1 : 0), WordConfiguration<Word>::WordSize, false };
 			result.scoreEndExists = frozenSqrtSlices[index].VPVNLastBit & 4;
 #ifdef EXTRACORRECTNESSASSERTIONS
-			result.confirmedRows.exists = result.scoreEndExists ? (((Word)1) << 63) : 0;
+			result.confirmedRows.exists = result.scoreEndExists ? (((Word)1) << (WordConfiguration<Word>::WordSize - 1)) : 0;
 #endif
 			return result;
 		}
@@ -350,9 +355,141 @@ public:
 		}
 		return result;
 	}
+	//the same columns as getFrozenScores, packed into a byte stream which can only be read in order
+	//each column is stored relative to the previous one: the change of plusMinScore as a zigzag varint together with scoreEndExists,
+	//then VP and VN xor'd with the previous column's as a varint mask of the nonzero bytes followed by those bytes,
+	//so a column with the same bitvectors as its predecessor takes three bytes
+	WordContainer getCompressedScores() const
+	{
+		if (frozen == 3) return *this;
+		assert(frozen == 0 || frozen == 1);
+		WordContainer result;
+		result.frozen = 3;
+		result.compressedCount = size();
+		if (size() == 0) return result;
+		result.minStartScore = (*this)[0].scoreBeforeStart;
+		for (size_t i = 1; i < size(); i++)
+		{
+			result.minStartScore = std::min(result.minStartScore, (*this)[i].scoreBeforeStart);
+		}
+		result.compressedSlices.reserve(size() * 4);
+		int64_t previousPlus = 0;
+		Word previousVP = WordConfiguration<Word>::AllZeros;
+		Word previousVN = WordConfiguration<Word>::AllZeros;
+#ifdef EXTRACORRECTNESSASSERTIONS
+		Word previousExists = WordConfiguration<Word>::AllZeros;
+#endif
+		for (size_t i = 0; i < size(); i++)
+		{
+			Slice slice = (*this)[i];
+			assert(slice.scoreBeforeStart >= result.minStartScore);
+			int64_t plus = slice.scoreBeforeStart - result.minStartScore;
+			int64_t delta = plus - previousPlus;
+			uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+			writeVarint(result.compressedSlices, (zigzag << 1) | (slice.scoreEndExists ? 1 : 0));
+			writeWordDelta(result.compressedSlices, slice.VP ^ previousVP);
+			writeWordDelta(result.compressedSlices, slice.VN ^ previousVN);
+#ifdef EXTRACORRECTNESSASSERTIONS
+			writeWordDelta(result.compressedSlices, slice.confirmedRows.exists ^ previousExists);
+			previousExists = slice.confirmedRows.exists;
+#endif
+			previousPlus = plus;
+			previousVP = slice.VP;
+			previousVN = slice.VN;
+		}
+		result.compressedSlices.shrink_to_fit();
+		return result;
+	}
+	//the same columns as getFrozenSqrtEndScores, each stored as the change of plusMinScore from the previous column
+	//as a zigzag varint together with the three bits of VPVNLastBit, so most columns take one byte
+	WordContainer getCompressedSqrtEndScores() const
+	{
+		if (frozen == 4) return *this;
+		assert(frozen == 2);
+		WordContainer result;
+		result.frozen = 4;
+		result.minEndScore = minEndScore;
+		result.compressedCount = frozenSqrtSlices.size();
+		result.compressedSlices.reserve(frozenSqrtSlices.size() * 2);
+		int64_t previousPlus = 0;
+		for (size_t i = 0; i < frozenSqrtSlices.size(); i++)
+		{
+			int64_t plus = frozenSqrtSlices[i].plusMinScore;
+			int64_t delta = plus - previousPlus;
+			uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+			writeVarint(result.compressedSlices, (zigzag << 3) | (frozenSqrtSlices[i].VPVNLastBit & 7));
+			previousPlus = plus;
+		}
+		result.compressedSlices.shrink_to_fit();
+		return result;
+	}
+	WordContainer getDecompressedScores() const
+	{
+		if (frozen == 4) return getDecompressedSqrtEndScores();
+		if (frozen != 3) return *this;
+		WordContainer result;
+		result.frozen = 1;
+		result.minStartScore = minStartScore;
+		result.frozenSlices.resize(compressedCount);
+		const uint8_t* pos = compressedSlices.data();
+		int64_t plus = 0;
+		Word VP = WordConfiguration<Word>::AllZeros;
+		Word VN = WordConfiguration<Word>::AllZeros;
+#ifdef EXTRACORRECTNESSASSERTIONS
+		Word exists = WordConfiguration<Word>::AllZeros;
+#endif
+		for (size_t i = 0; i < compressedCount; i++)
+		{
+			uint64_t header = readVarint(pos);
+			uint64_t zigzag = header >> 1;
+			plus += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+			VP ^= readWordDelta(pos);
+			VN ^= readWordDelta(pos);
+			assert(plus >= 0);
+			assert(plus < std::numeric_limits<decltype(frozenSlices[i].plusMinScore)>::max());
+			result.frozenSlices[i].VP = VP;
+			result.frozenSlices[i].VN = VN;
+			result.frozenSlices[i].plusMinScore = plus;
+			result.frozenSlices[i].scoreEndExists = header & 1;
+#ifdef EXTRACORRECTNESSASSERTIONS
+			exists ^= readWordDelta(pos);
+			result.frozenSlices[i].exists = exists;
+#endif
+		}
+		assert(pos == compressedSlices.data() + compressedSlices.size());
+		return result;
+	}
+	WordContainer getDecompressedSqrtEndScores() const
+	{
+		assert(frozen == 4);
+		WordContainer result;
+		result.frozen = 2;
+		result.minEndScore = minEndScore;
+		result.frozenSqrtSlices.resize(compressedCount);
+		const uint8_t* pos = compressedSlices.data();
+		int64_t plus = 0;
+		for (size_t i = 0; i < compressedCount; i++)
+		{
+			uint64_t header = readVarint(pos);
+			uint64_t zigzag = header >> 3;
+			plus += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+			assert(plus >= 0);
+			assert(plus < std::numeric_limits<decltype(frozenSqrtSlices[i].plusMinScore)>::max());
+			result.frozenSqrtSlices[i].plusMinScore = plus;
+			result.frozenSqrtSlices[i].VPVNLastBit = header & 7;
+		}
+		assert(pos == compressedSlices.data() + compressedSlices.size());
+		return result;
+	}
+	//bytes of the columns in their current representation
+	size_t MemoryUsage() const
+	{
+		return mutableSlices.capacity() * sizeof(Slice) + frozenSlices.capacity() * sizeof(SmallSlice) + frozenSqrtSlices.capacity() * sizeof(TinySlice) + compressedSlices.capacity();
+	}
 	WordContainer getFrozenSqrtEndScores() const
 	{
 		if (frozen == 2) return *this;
+		if (frozen == 4) return getDecompressedSqrtEndScores();
 		assert(frozen == 0);
 		WordContainer result;
 		result.frozen = 2;
@@ -362,11 +499,12 @@ public:
 		{
 			result.minEndScore = std::min(result.minEndScore, mutableSlices[i].scoreEnd);
 		}
+		const Word lastBitMask = ((Word)1) << (WordConfiguration<Word>::WordSize - 1);
 		for (size_t i = 0; i < mutableSlices.size(); i++)
 		{
 			result.frozenSqrtSlices[i].VPVNLastBit = 0;
-			result.frozenSqrtSlices[i].VPVNLastBit |= mutableSlices[i].VP >> 63;
-			result.frozenSqrtSlices[i].VPVNLastBit |= (mutableSlices[i].VN >> 62) & 2;
+			if (mutableSlices[i].VP & lastBitMask) result.frozenSqrtSlices[i].VPVNLastBit |= 1;
+			if (mutableSlices[i].VN & lastBitMask) result.frozenSqrtSlices[i].VPVNLastBit |= 2;
 			result.frozenSqrtSlices[i].VPVNLastBit |= mutableSlices[i].scoreEndExists << 2;
 			assert(mutableSlices[i].scoreEnd >= result.minEndScore);
 			assert(mutableSlices[i].scoreEnd - result.minEndScore < std::numeric_limits<decltype(frozenSqrtSlices[i].plusMinScore)>::max());
@@ -392,7 +530,17 @@ public:
 	}
 	size_t size() const
 	{
-		return frozen == 0 ? mutableSlices.size() : frozen == 1 ? frozenSlices.size() : frozenSqrtSlices.size();
+		switch(frozen)
+		{
+			case 0:
+				return mutableSlices.size();
+			case 1:
+				return frozenSlices.size();
+			case 2:
+				return frozenSqrtSlices.size();
+			default:
+				return compressedCount;
+		}
 	}
 	void resize(size_t size)
 	{
@@ -415,12 +563,71 @@ public:
 	}
 	ScoreType minScore;
 private:
+	static void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((value & 0x7F) | 0x80);
+			value >>= 7;
+		}
+		out.push_back(value);
+	}
+	static uint64_t readVarint(const uint8_t*& pos)
+	{
+		uint64_t result = 0;
+		int shift = 0;
+		while (*pos & 0x80)
+		{
+			result |= ((uint64_t)(*pos & 0x7F)) << shift;
+			shift += 7;
+			pos++;
+		}
+		result |= ((uint64_t)*pos) << shift;
+		pos++;
+		return result;
+	}
+	static_assert(sizeof(Word) <= 64, "the mask of nonzero bytes must fit in a varint");
+	static void writeWordDelta(std::vector<uint8_t>& out, Word value)
+	{
+		uint8_t bytes[sizeof(Word)];
+		memcpy(bytes, &value, sizeof(Word));
+		uint64_t mask = 0;
+		for (size_t i = 0; i < sizeof(Word); i++)
+		{
+			if (bytes[i] != 0) mask |= ((uint64_t)1) << i;
+		}
+		writeVarint(out, mask);
+		for (size_t i = 0; i < sizeof(Word); i++)
+		{
+			if (bytes[i] != 0) out.push_back(bytes[i]);
+		}
+	}
+	static Word readWordDelta(const uint8_t*& pos)
+	{
+		uint64_t mask = readVarint(pos);
+		uint8_t bytes[sizeof(Word)] = {};
+		for (size_t i = 0; i < sizeof(Word); i++)
+		{
+			if (mask & (((uint64_t)1) << i))
+			{
+				bytes[i] = *pos;
+				pos++;
+			}
+		}
+		Word result;
+		memcpy(&result, bytes, sizeof(Word));
+		return result;
+	}
 	ScoreType minEndScore;
 	ScoreType minStartScore;
+	//0: mutable, 1: frozen scores, 2: frozen end scores, 3: compressed frozen scores, 4: compressed frozen end scores
 	int frozen;
 	std::vector<Slice> mutableSlices;
 	std::vector<SmallSlice> frozenSlices;
 	std::vector<TinySlice> frozenSqrtSlices;
+	//the packed columns and their number when the scores are compressed, see getCompressedScores and getCompressedSqrtEndScores
+	std::vector<uint8_t> compressedSlices;
+	size_t compressedCount;
 };
 
 template <typename T>
@@ -428,8 +635,8 @@ class NodeSlice
 {
 public:
 	using MapItem = std::tuple<size_t, size_t, int>;
-	using Container = WordContainer<size_t, int, uint64_t>;
-	using View = Container::ContainerView;
+	using Container = WordContainer<typename T::Length, typename T::Score, decltype(T::VP)>;
+	using View = typename Container::ContainerView;
 	class NodeSliceIterator : std::iterator<std::forward_iterator_tag, std::pair<size_t, View>>
 	{
 		using map_iterator = typename std::unordered_map<size_t, std::tuple<size_t, size_t, int>>::iterator;
@@ -564,7 +771,7 @@ public:
 	vectorMap(nullptr)
 	{
 	}
-	NodeSlice(std::vector<MapItem>* vectorMap) :
+	NodeSlice(EpochVector<MapItem>* vectorMap) :
 	vectorMap(vectorMap)
 	{
 	}
@@ -573,7 +780,7 @@ public:
 		assert(vectorMap != nullptr);
 		for (auto index : activeVectorMapIndices)
 		{
-			(*vectorMap)[index] = std::make_tuple(0, 0, 0);
+			vectorMap->set(index, std::make_tuple(0, 0, 0));
 		}
 		activeVectorMapIndices.clear();
 	}
@@ -587,7 +794,7 @@ public:
 		{
 			assert(nodeIndex < vectorMap->size());
 			assert(std::get<0>((*vectorMap)[nodeIndex]) == std::get<1>((*vectorMap)[nodeIndex]));
-			(*vectorMap)[nodeIndex] = { slices.size(), slices.size() + size, 0 };
+			vectorMap->set(nodeIndex, MapItem { slices.size(), slices.size() + size, 0 });
 			activeVectorMapIndices.push_back(nodeIndex);
 		}
 		else
@@ -627,6 +834,26 @@ public:
 			return slices.getView(std::get<0>(found->second), std::get<1>(found->second), std::get<2>(found->second));
 		}
 	}
+	//index of the node's first column in the slice. the columns of all nodes are numbered 0..totalColumns()-1
+	size_t firstColumn(size_t nodeIndex) const
+	{
+		if (vectorMap != nullptr)
+		{
+			assert(nodeIndex < vectorMap->size());
+			assert(std::get<0>((*vectorMap)[nodeIndex]) != std::get<1>((*vectorMap)[nodeIndex]));
+			return std::get<0>((*vectorMap)[nodeIndex]);
+		}
+		else
+		{
+			auto found = nodes.find(nodeIndex);
+			assert(found != nodes.end());
+			return std::get<0>(found->second);
+		}
+	}
+	size_t totalColumns() const
+	{
+		return slices.size();
+	}
 	bool hasNode(size_t nodeIndex) const
 	{
 		if (vectorMap != nullptr)
@@ -659,7 +886,9 @@ public:
 		if (vectorMap != nullptr)
 		{
 			assert(nodeIndex < vectorMap->size());
-			std::get<2>((*vectorMap)[nodeIndex]) = score;
+			auto item = (*vectorMap)[nodeIndex];
+			std::get<2>(item) = score;
+			vectorMap->set(nodeIndex, item);
 		}
 		else
 		{
@@ -738,6 +967,58 @@ public:
 		}
 		return result;
 	}
+	NodeSlice getCompressedScores() const
+	{
+		NodeSlice result;
+		result.slices = slices.getCompressedScores();
+		if (vectorMap != nullptr)
+		{
+			for (auto index : activeVectorMapIndices)
+			{
+				result.nodes[index] = (*vectorMap)[index];
+			}
+		}
+		else
+		{
+			result.nodes = nodes;
+		}
+		return result;
+	}
+	NodeSlice getCompressedSqrtEndScores() const
+	{
+		NodeSlice result;
+		result.slices = slices.getCompressedSqrtEndScores();
+		if (vectorMap != nullptr)
+		{
+			for (auto index : activeVectorMapIndices)
+			{
+				result.nodes[index] = (*vectorMap)[index];
+			}
+		}
+		else
+		{
+			result.nodes = nodes;
+		}
+		return result;
+	}
+	NodeSlice getDecompressedScores() const
+	{
+		assert(vectorMap == nullptr);
+		NodeSlice result;
+		result.slices = slices.getDecompressedScores();
+		result.nodes = nodes;
+		return result;
+	}
+	//columns in their current representation plus an approximation of the node map
+	size_t MemoryUsage() const
+	{
+		return slices.MemoryUsage() + size() * (sizeof(size_t) + sizeof(MapItem) + 2 * sizeof(void*));
+	}
+	//bytes of the same columns stored as frozen scores
+	size_t FrozenScoresMemoryUsage() const
+	{
+		return slices.size() * sizeof(typename Container::SmallSlice);
+	}
 	NodeSlice getFrozenScores() const
 	{
 		NodeSlice result;
@@ -756,7 +1037,7 @@ public:
 		return result;
 	}
 private:
-	std::vector<MapItem>* vectorMap;
+	EpochVector<MapItem>* vectorMap;
 	std::vector<size_t> activeVectorMapIndices;
 	std::unordered_map<size_t, MapItem> nodes;
 	Container slices;
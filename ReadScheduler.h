@@ -0,0 +1,104 @@
+#ifndef ReadScheduler_h
+#define ReadScheduler_h
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "fastqloader.h"
+#include "ThreadReadAssertion.h"
+
+//hands out reads to the alignment threads longest first
+//the reads are streamed so only the reads in the window (at most maxReads reads and maxBases bases) can be reordered
+//reads shorter than batchLength are handed out batchSize at a time
+//tracks how long each thread waits for reads
+class ReadScheduler
+{
+public:
+	ReadScheduler(size_t numThreads, size_t maxReads, size_t maxBases, size_t batchLength, size_t batchSize) :
+	maxReads(maxReads),
+	maxBases(maxBases),
+	batchLength(batchLength),
+	batchSize(batchSize),
+	closed(false),
+	bases(0),
+	waitMilliseconds(numThreads, 0)
+	{
+		assert(maxReads > 0);
+		assert(batchSize > 0);
+	}
+	void push(FastQ read)
+	{
+		std::unique_lock<std::mutex> lock {mutex};
+		//a read longer than maxBases is still accepted when the window is empty
+		notFull.wait(lock, [this]() { return reads.size() == 0 || (reads.size() < maxReads && bases < maxBases); });
+		assert(!closed);
+		bases += read.sequence.size();
+		reads.emplace_back(std::move(read));
+		std::push_heap(reads.begin(), reads.end(), ShorterRead);
+		lock.unlock();
+		notEmpty.notify_one();
+	}
+	bool pop(size_t threadnum, std::vector<FastQ>& batch)
+	{
+		assert(threadnum < waitMilliseconds.size());
+		batch.clear();
+		std::unique_lock<std::mutex> lock {mutex};
+		if (reads.size() == 0 && !closed)
+		{
+			auto waitStart = std::chrono::system_clock::now();
+			notEmpty.wait(lock, [this]() { return reads.size() > 0 || closed; });
+			auto waitEnd = std::chrono::system_clock::now();
+			waitMilliseconds[threadnum] += std::chrono::duration_cast<std::chrono::milliseconds>(waitEnd - waitStart).count();
+		}
+		if (reads.size() == 0) return false;
+		do
+		{
+			std::pop_heap(reads.begin(), reads.end(), ShorterRead);
+			bases -= reads.back().sequence.size();
+			batch.emplace_back(std::move(reads.back()));
+			reads.pop_back();
+		} while (reads.size() > 0 && batch.size() < batchSize && batch.back().sequence.size() < batchLength);
+		lock.unlock();
+		notFull.notify_all();
+		return true;
+	}
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock {mutex};
+			closed = true;
+		}
+		notEmpty.notify_all();
+		notFull.notify_all();
+	}
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> lock {mutex};
+		return reads.size();
+	}
+	size_t waitTime(size_t threadnum) const
+	{
+		std::lock_guard<std::mutex> lock {mutex};
+		return waitMilliseconds[threadnum];
+	}
+private:
+	static bool ShorterRead(const FastQ& left, const FastQ& right)
+	{
+		return left.sequence.size() < right.sequence.size();
+	}
+	size_t maxReads;
+	size_t maxBases;
+	size_t batchLength;
+	size_t batchSize;
+	bool closed;
+	size_t bases;
+	std::vector<FastQ> reads;
+	std::vector<size_t> waitMilliseconds;
+	mutable std::mutex mutex;
+	std::condition_variable notEmpty;
+	std::condition_variable notFull;
+};
+
+#endif
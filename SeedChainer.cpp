@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include "SeedChainer.h"
+#include "ThreadReadAssertion.h"
+
+SeedChainer::SeedChainer(const AlignmentGraph& graph, size_t maxGap) :
+graph(graph),
+maxGap(maxGap)
+{
+}
+
+size_t SeedChainer::allowedDifference(size_t readGap)
+{
+	//indels in long reads, plus some slack for short gaps
+	return readGap / 5 + 50;
+}
+
+void SeedChainer::distancesToLaterAnchors(const std::vector<Anchor>& anchors, size_t from, std::vector<size_t>& distances) const
+{
+	std::fill(distances.begin(), distances.end(), std::numeric_limits<size_t>::max());
+	std::unordered_map<size_t, size_t> targets;
+	for (size_t i = from+1; i < anchors.size() && anchors[i].readPos - anchors[from].readPos <= maxGap; i++)
+	{
+		if (anchors[i].inGraph) targets[anchors[i].node] = std::numeric_limits<size_t>::max();
+	}
+	if (targets.size() == 0) return;
+	size_t maxDistance = maxGap + allowedDifference(maxGap);
+	size_t targetsFound = 0;
+	//dijkstra over the node starts. it starts from the out-neighbors so a later anchor on the same node
+	//is found one loop later, the same visit of the node is handled by the caller
+	std::unordered_map<size_t, size_t> distanceAtNodeStart;
+	std::priority_queue<std::pair<size_t, size_t>, std::vector<std::pair<size_t, size_t>>, std::greater<std::pair<size_t, size_t>>> queue;
+	for (auto neighbor : graph.outNeighbors[anchors[from].node])
+	{
+		queue.emplace(graph.NodeLength(anchors[from].node), neighbor);
+	}
+	while (queue.size() > 0 && targetsFound < targets.size())
+	{
+		auto top = queue.top();
+		queue.pop();
+		if (top.first > maxDistance) break;
+		if (distanceAtNodeStart.count(top.second) == 1) continue;
+		distanceAtNodeStart[top.second] = top.first;
+		auto found = targets.find(top.second);
+		if (found != targets.end())
+		{
+			found->second = top.first;
+			targetsFound++;
+		}
+		size_t distanceAtEnd = top.first + graph.NodeLength(top.second);
+		for (auto neighbor : graph.outNeighbors[top.second])
+		{
+			if (distanceAtNodeStart.count(neighbor) == 0) queue.emplace(distanceAtEnd, neighbor);
+		}
+	}
+	for (size_t i = from+1; i < anchors.size() && anchors[i].readPos - anchors[from].readPos <= maxGap; i++)
+	{
+		if (anchors[i].inGraph) distances[i] = targets[anchors[i].node];
+	}
+}
+
+std::vector<std::tuple<int, size_t, bool>> SeedChainer::BestChainSeeds(const std::vector<std::tuple<int, size_t, bool>>& seeds, size_t maxChains, size_t& numChains, size_t& droppedSeeds) const
+{
+	std::vector<Anchor> anchors;
+	anchors.reserve(seeds.size());
+	for (size_t i = 0; i < seeds.size(); i++)
+	{
+		Anchor anchor;
+		anchor.readPos = std::get<1>(seeds[i]);
+		int nodeId = std::get<0>(seeds[i]) * 2 + (std::get<2>(seeds[i]) ? 1 : 0);
+		//seeds to nodes which aren't in the graph get their own chain, the aligner reports them
+		anchor.inGraph = graph.nodeLookup.count(nodeId) == 1;
+		anchor.node = anchor.inGraph ? graph.nodeLookup.at(nodeId) : 0;
+		anchor.seed = i;
+		anchors.push_back(anchor);
+	}
+	std::sort(anchors.begin(), anchors.end(), [](const Anchor& left, const Anchor& right) { return left.readPos < right.readPos || (left.readPos == right.readPos && left.seed < right.seed); });
+	//longest chain ending at each anchor
+	std::vector<size_t> chainLength(anchors.size(), 1);
+	std::vector<size_t> previous(anchors.size(), std::numeric_limits<size_t>::max());
+	std::vector<size_t> distances(anchors.size());
+	for (size_t i = 0; i < anchors.size(); i++)
+	{
+		if (!anchors[i].inGraph) continue;
+		distancesToLaterAnchors(anchors, i, distances);
+		for (size_t j = i+1; j < anchors.size() && anchors[j].readPos - anchors[i].readPos <= maxGap; j++)
+		{
+			size_t readGap = anchors[j].readPos - anchors[i].readPos;
+			bool colinear = false;
+			if (distances[j] != std::numeric_limits<size_t>::max())
+			{
+				size_t difference = distances[j] > readGap ? distances[j] - readGap : readGap - distances[j];
+				colinear = difference <= allowedDifference(readGap);
+			}
+			//or in the same visit of the same node
+			if (anchors[j].inGraph && anchors[j].node == anchors[i].node && readGap <= allowedDifference(readGap)) colinear = true;
+			if (!colinear) continue;
+			if (chainLength[i] + 1 > chainLength[j])
+			{
+				chainLength[j] = chainLength[i] + 1;
+				previous[j] = i;
+			}
+		}
+	}
+	//take chains from the longest end, a chain stops where it reaches an anchor of an earlier chain
+	std::vector<size_t> order;
+	for (size_t i = 0; i < anchors.size(); i++)
+	{
+		order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&chainLength, &anchors](size_t left, size_t right) { return chainLength[left] > chainLength[right] || (chainLength[left] == chainLength[right] && anchors[left].seed < anchors[right].seed); });
+	std::vector<bool> used(anchors.size(), false);
+	//chain of each input seed
+	std::vector<size_t> chainOfSeed(seeds.size());
+	//size and the earliest input seed of each chain
+	std::vector<std::pair<size_t, size_t>> chains;
+	for (auto end : order)
+	{
+		if (used[end]) continue;
+		size_t size = 0;
+		size_t firstSeed = anchors[end].seed;
+		for (size_t i = end; i != std::numeric_limits<size_t>::max() && !used[i]; i = previous[i])
+		{
+			used[i] = true;
+			size++;
+			firstSeed = std::min(firstSeed, anchors[i].seed);
+			chainOfSeed[anchors[i].seed] = chains.size();
+		}
+		chains.emplace_back(size, firstSeed);
+	}
+	std::vector<size_t> chainOrder;
+	for (size_t i = 0; i < chains.size(); i++)
+	{
+		chainOrder.push_back(i);
+	}
+	std::sort(chainOrder.begin(), chainOrder.end(), [&chains](size_t left, size_t right) { return chains[left].first > chains[right].first || (chains[left].first == chains[right].first && chains[left].second < chains[right].second); });
+	numChains = chains.size();
+	droppedSeeds = 0;
+	std::vector<std::tuple<int, size_t, bool>> result;
+	if (maxChains == 0)
+	{
+		//every seed, the best chain's first so the aligner tries them first, within a chain in the input order
+		std::vector<size_t> chainRank(chains.size());
+		for (size_t i = 0; i < chainOrder.size(); i++)
+		{
+			chainRank[chainOrder[i]] = i;
+		}
+		std::vector<size_t> seedOrder;
+		for (size_t i = 0; i < seeds.size(); i++)
+		{
+			seedOrder.push_back(i);
+		}
+		std::stable_sort(seedOrder.begin(), seedOrder.end(), [&chainRank, &chainOfSeed](size_t left, size_t right) { return chainRank[chainOfSeed[left]] < chainRank[chainOfSeed[right]]; });
+		for (auto seed : seedOrder)
+		{
+			result.push_back(seeds[seed]);
+		}
+		return result;
+	}
+	for (size_t i = 0; i < chainOrder.size(); i++)
+	{
+		if (i >= maxChains)
+		{
+			droppedSeeds += chains[chainOrder[i]].first;
+			continue;
+		}
+		//the other seeds of the chain are collapsed into its first one
+		droppedSeeds += chains[chainOrder[i]].first - 1;
+		result.push_back(seeds[chains[chainOrder[i]].second]);
+	}
+	return result;
+}
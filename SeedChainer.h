@@ -0,0 +1,41 @@
+#ifndef SeedChainer_h
+#define SeedChainer_h
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include "AlignmentGraph.h"
+
+//groups a read's seed hits into colinear chains before they're extended
+//two seeds are colinear if the graph distance between them is about the same as the read distance,
+//then they're probably the same locus and one extension aligns both
+class SeedChainer
+{
+public:
+	//seeds further apart than this in the read aren't chained directly, a chain can still continue through seeds between them
+	static constexpr size_t DefaultMaxGap = 5000;
+	SeedChainer(const AlignmentGraph& graph, size_t maxGap = DefaultMaxGap);
+	//seeds for AlignOneWay, the best chain first. chains are ranked by the number of seeds, ties by their earliest seed in the input order
+	//if maxChains is 0 every seed is returned grouped by chain, otherwise the earliest seed of each of the best maxChains chains
+	//numChains is set to the number of chains and droppedSeeds to the number of seeds which aren't returned
+	std::vector<std::tuple<int, size_t, bool>> BestChainSeeds(const std::vector<std::tuple<int, size_t, bool>>& seeds, size_t maxChains, size_t& numChains, size_t& droppedSeeds) const;
+private:
+	class Anchor
+	{
+	public:
+		size_t readPos;
+		size_t node;
+		bool inGraph;
+		//index in the input seeds
+		size_t seed;
+	};
+	//the gap between two seeds may differ this much between the read and the graph
+	static size_t allowedDifference(size_t readGap);
+	//graph distances from the start of anchors[from]'s node to the starts of the later anchors' nodes.
+	//a later anchor on the same node gets the length of the shortest cycle through the node, or max if there's none
+	void distancesToLaterAnchors(const std::vector<Anchor>& anchors, size_t from, std::vector<size_t>& distances) const;
+	const AlignmentGraph& graph;
+	size_t maxGap;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "vg.pb.h"
+#include "CommonUtils.h"
+#include "BigraphToDigraph.h"
+#include "AlignmentGraph.h"
+#include "SeedChainer.h"
+
+//checks SeedChainer on test/smallexample and on small hand made graphs
+//run from the repository root, exits nonzero if a check fails
+
+size_t failures = 0;
+
+void check(bool condition, const std::string& name)
+{
+	if (!condition)
+	{
+		std::cerr << "FAIL " << name << std::endl;
+		failures++;
+	}
+	else
+	{
+		std::cerr << "ok " << name << std::endl;
+	}
+}
+
+int addNode(vg::Graph& graph, const std::string& sequence)
+{
+	auto node = graph.add_node();
+	node->set_id(graph.node_size());
+	node->set_sequence(sequence);
+	return node->id();
+}
+
+void addEdge(vg::Graph& graph, int from, int to)
+{
+	auto edge = graph.add_edge();
+	edge->set_from(from);
+	edge->set_to(to);
+}
+
+size_t countChains(const SeedChainer& chainer, const std::vector<std::tuple<int, size_t, bool>>& seeds)
+{
+	size_t numChains = 0;
+	size_t droppedSeeds = 0;
+	chainer.BestChainSeeds(seeds, 0, numChains, droppedSeeds);
+	return numChains;
+}
+
+//seeds along a path through the graph chain together, a seed far off in the read doesn't
+void testSmallExample()
+{
+	auto bigraph = CommonUtils::LoadVGGraph("test/smallexample/sub_test.vg");
+	auto graph = DirectedGraph::BuildFromVG(bigraph);
+	SeedChainer chainer { graph };
+	std::unordered_map<int, size_t> nodeLength;
+	for (int i = 0; i < bigraph.node_size(); i++)
+	{
+		nodeLength[bigraph.node(i).id()] = bigraph.node(i).sequence().size();
+	}
+	//a seed at the start of every node of the path
+	std::vector<int> path { 6730, 6731, 6732, 6733, 6734, 6738, 6739, 6740, 6742, 6743, 6744, 6747 };
+	std::vector<std::tuple<int, size_t, bool>> seeds;
+	size_t readPos = 0;
+	for (auto node : path)
+	{
+		seeds.emplace_back(node, readPos, false);
+		readPos += nodeLength[node];
+	}
+	check(countChains(chainer, seeds) == 1, "smallexample path seeds make one chain");
+	size_t numChains = 0;
+	size_t droppedSeeds = 0;
+	auto all = chainer.BestChainSeeds(seeds, 0, numChains, droppedSeeds);
+	check(all == seeds && droppedSeeds == 0, "smallexample max chains 0 keeps every seed of the chain");
+	auto misplaced = seeds;
+	misplaced.emplace_back(std::get<0>(seeds[0]), readPos + 2000, std::get<2>(seeds[0]));
+	check(countChains(chainer, misplaced) == 2, "smallexample misplaced seed makes its own chain");
+	auto missing = seeds;
+	missing.emplace_back(1000000, 0, false);
+	check(countChains(chainer, missing) == 2, "smallexample seed outside the graph makes its own chain");
+}
+
+//a -> b -> a loop with 100bp nodes
+void testCycle()
+{
+	vg::Graph bigraph;
+	int a = addNode(bigraph, std::string(50, 'A') + std::string(50, 'C'));
+	int b = addNode(bigraph, std::string(50, 'G') + std::string(50, 'T'));
+	addEdge(bigraph, a, b);
+	addEdge(bigraph, b, a);
+	auto graph = DirectedGraph::BuildFromVG(bigraph);
+	SeedChainer chainer { graph };
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(a, 200, false) }) == 1, "cycle seeds one loop apart make one chain");
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(a, 200, false), std::make_tuple(a, 400, false) }) == 1, "cycle seeds in three loops make one chain");
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(a, 30, false) }) == 1, "cycle seeds in the same visit make one chain");
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(a, 120, false) }) == 2, "cycle seeds neither in the same visit nor a loop apart make two chains");
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(b, 100, false), std::make_tuple(a, 200, false) }) == 1, "cycle seeds through both nodes make one chain");
+}
+
+//a -> b without a loop, a later seed on a can't be one loop later
+void testNoCycle()
+{
+	vg::Graph bigraph;
+	int a = addNode(bigraph, std::string(50, 'A') + std::string(50, 'C'));
+	int b = addNode(bigraph, std::string(50, 'G') + std::string(50, 'T'));
+	addEdge(bigraph, a, b);
+	auto graph = DirectedGraph::BuildFromVG(bigraph);
+	SeedChainer chainer { graph };
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(a, 200, false) }) == 2, "acyclic seeds on the same node far apart make two chains");
+	check(countChains(chainer, { std::make_tuple(a, 0, false), std::make_tuple(b, 100, false) }) == 1, "acyclic seeds on consecutive nodes make one chain");
+}
+
+//without a cut every seed comes back grouped by chain, the cut keeps the first seed of the biggest chains and reports the rest
+void testMaxChains()
+{
+	vg::Graph bigraph;
+	int a = addNode(bigraph, std::string(50, 'A') + std::string(50, 'C'));
+	int b = addNode(bigraph, std::string(50, 'G') + std::string(50, 'T'));
+	int c = addNode(bigraph, std::string(50, 'A') + std::string(50, 'G'));
+	addEdge(bigraph, a, b);
+	auto graph = DirectedGraph::BuildFromVG(bigraph);
+	SeedChainer chainer { graph };
+	//chains {a@0, b@100}, {c@1000} and {c@3000}
+	std::vector<std::tuple<int, size_t, bool>> seeds { std::make_tuple(c, 1000, false), std::make_tuple(a, 0, false), std::make_tuple(b, 100, false), std::make_tuple(c, 3000, false) };
+	size_t numChains = 0;
+	size_t droppedSeeds = 0;
+	auto all = chainer.BestChainSeeds(seeds, 0, numChains, droppedSeeds);
+	std::vector<std::tuple<int, size_t, bool>> expected { seeds[1], seeds[2], seeds[0], seeds[3] };
+	check(numChains == 3 && all == expected && droppedSeeds == 0, "max chains 0 keeps every seed, the biggest chain first");
+	auto cut = chainer.BestChainSeeds(seeds, 1, numChains, droppedSeeds);
+	check(numChains == 3 && cut.size() == 1 && cut[0] == seeds[1] && droppedSeeds == 3, "max chains 1 drops the two small chains and the collapsed seed");
+	cut = chainer.BestChainSeeds(seeds, 5, numChains, droppedSeeds);
+	check(numChains == 3 && cut.size() == 3 && droppedSeeds == 1, "max chains above the chain count keeps every chain and drops the collapsed seed");
+}
+
+int main(int argc, char** argv)
+{
+	testSmallExample();
+	testCycle();
+	testNoCycle();
+	testMaxChains();
+	if (failures > 0)
+	{
+		std::cerr << failures << " checks failed" << std::endl;
+		return 1;
+	}
+	std::cerr << "all checks passed" << std::endl;
+	return 0;
+}
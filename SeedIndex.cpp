@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include "SeedIndex.h"
+#include "IndexFormat.h"
+#include "ThreadReadAssertion.h"
+
+const char SeedIndexMagic[8] = { 'G', 'A', 'S', 'E', 'E', 'D', 'S', 0 };
+const uint64_t SeedIndexVersion = 1;
+
+//2-bit code of a base, -1 for anything else
+int baseCode(char c)
+{
+	switch(c)
+	{
+		case 'A':
+		case 'a':
+			return 0;
+		case 'C':
+		case 'c':
+			return 1;
+		case 'G':
+		case 'g':
+			return 2;
+		case 'T':
+		case 't':
+			return 3;
+		default:
+			return -1;
+	}
+}
+
+uint64_t hashKmer(uint64_t kmer)
+{
+	kmer ^= kmer >> 33;
+	kmer *= 0xff51afd7ed558ccdULL;
+	kmer ^= kmer >> 33;
+	kmer *= 0xc4ceb9fe1a85ec53ULL;
+	kmer ^= kmer >> 33;
+	return kmer;
+}
+
+SeedIndex::SeedIndex() :
+kmerSize(0),
+samplingRate(1),
+graphSize(0),
+kmers(),
+positions(),
+mappedIndex()
+{
+}
+
+SeedIndex::SeedIndex(const AlignmentGraph& graph, size_t kmerSize, size_t samplingRate) :
+kmerSize(kmerSize),
+samplingRate(samplingRate),
+graphSize(graph.SizeInBp()),
+kmers(),
+positions(),
+mappedIndex()
+{
+	assert(kmerSize > 0);
+	assert(kmerSize <= 31);
+	assert(samplingRate > 0);
+	std::vector<std::pair<uint64_t, size_t>> result;
+	uint64_t mask = ((uint64_t)1 << (2 * kmerSize)) - 1;
+	//skip the dummy start and end nodes
+	for (size_t node = 1; node < graph.NodeSize() - 1; node++)
+	{
+		size_t start = graph.NodeStart(node);
+		size_t end = graph.NodeEnd(node);
+		uint64_t kmer = 0;
+		//k-mers containing ambiguous bases are not indexed
+		size_t validLength = 0;
+		for (size_t pos = start; pos < end; pos++)
+		{
+			int code = baseCode(graph.NodeSequences(pos));
+			if (code == -1)
+			{
+				kmer = 0;
+				validLength = 0;
+				continue;
+			}
+			kmer = ((kmer << 2) | code) & mask;
+			validLength++;
+			if (validLength >= kmerSize) addKmer(kmer, pos + 1 - kmerSize, result);
+		}
+		//k-mers which continue to the next nodes
+		for (size_t pos = std::max(start, end >= kmerSize ? end - kmerSize + 1 : start); pos < end; pos++)
+		{
+			addSpanningKmers(graph, node, pos, result);
+		}
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	std::vector<uint64_t> sortedKmers;
+	std::vector<size_t> sortedPositions;
+	sortedKmers.reserve(result.size());
+	sortedPositions.reserve(result.size());
+	for (auto pair : result)
+	{
+		sortedKmers.push_back(pair.first);
+		sortedPositions.push_back(pair.second);
+	}
+	kmers.assign(std::move(sortedKmers));
+	positions.assign(std::move(sortedPositions));
+}
+
+bool SeedIndex::sampled(uint64_t kmer) const
+{
+	return hashKmer(kmer) % samplingRate == 0;
+}
+
+void SeedIndex::addKmer(uint64_t kmer, size_t position, std::vector<std::pair<uint64_t, size_t>>& result) const
+{
+	if (sampled(kmer)) result.emplace_back(kmer, position);
+}
+
+void SeedIndex::addSpanningKmers(const AlignmentGraph& graph, size_t node, size_t position, std::vector<std::pair<uint64_t, size_t>>& result) const
+{
+	//depth first over the paths starting at position, until each has kmerSize bases
+	//highly branching regions would explode, so stop after MaxSpanningKmersPerPosition k-mers
+	uint64_t kmer = 0;
+	size_t length = 0;
+	for (size_t pos = position; pos < graph.NodeEnd(node); pos++)
+	{
+		int code = baseCode(graph.NodeSequences(pos));
+		if (code == -1) return;
+		kmer = (kmer << 2) | code;
+		length++;
+	}
+	assert(length < kmerSize);
+	std::vector<std::tuple<size_t, uint64_t, size_t>> stack;
+	for (auto neighbor : graph.outNeighbors[node])
+	{
+		stack.emplace_back(neighbor, kmer, length);
+	}
+	size_t found = 0;
+	while (stack.size() > 0 && found < MaxSpanningKmersPerPosition)
+	{
+		size_t current = std::get<0>(stack.back());
+		uint64_t currentKmer = std::get<1>(stack.back());
+		size_t currentLength = std::get<2>(stack.back());
+		stack.pop_back();
+		size_t pos = graph.NodeStart(current);
+		bool ambiguous = false;
+		for (; pos < graph.NodeEnd(current) && currentLength < kmerSize; pos++)
+		{
+			int code = baseCode(graph.NodeSequences(pos));
+			if (code == -1)
+			{
+				ambiguous = true;
+				break;
+			}
+			currentKmer = (currentKmer << 2) | code;
+			currentLength++;
+		}
+		if (ambiguous) continue;
+		if (currentLength == kmerSize)
+		{
+			addKmer(currentKmer, position, result);
+			found++;
+			continue;
+		}
+		for (auto neighbor : graph.outNeighbors[current])
+		{
+			stack.emplace_back(neighbor, currentKmer, currentLength);
+		}
+	}
+}
+
+std::vector<std::tuple<int, size_t, bool>> SeedIndex::GetSeeds(const AlignmentGraph& graph, const std::string& sequence, size_t maxSeeds) const
+{
+	assert(graph.SizeInBp() == graphSize);
+	//k-mer hits vote for the read position of their node's start
+	std::map<std::pair<size_t, size_t>, size_t> votes;
+	uint64_t mask = ((uint64_t)1 << (2 * kmerSize)) - 1;
+	uint64_t kmer = 0;
+	size_t validLength = 0;
+	for (size_t i = 0; i < sequence.size(); i++)
+	{
+		int code = baseCode(sequence[i]);
+		if (code == -1)
+		{
+			validLength = 0;
+			continue;
+		}
+		kmer = ((kmer << 2) | code) & mask;
+		validLength++;
+		if (validLength < kmerSize) continue;
+		if (!sampled(kmer)) continue;
+		size_t readPos = i + 1 - kmerSize;
+		auto range = std::equal_range(kmers.begin(), kmers.end(), kmer);
+		if (range.second - range.first > (ptrdiff_t)MaxKmerOccurrences) continue;
+		for (auto hit = range.first; hit != range.second; ++hit)
+		{
+			size_t graphPos = positions[hit - kmers.begin()];
+			size_t node = graph.IndexToNode(graphPos);
+			size_t offset = graphPos - graph.NodeStart(node);
+			if (offset > readPos) continue;
+			if (readPos - offset + graph.DBGOverlap > sequence.size()) continue;
+			votes[std::make_pair(node, readPos - offset)]++;
+		}
+	}
+	std::vector<std::pair<size_t, std::pair<size_t, size_t>>> sortedVotes;
+	for (auto pair : votes)
+	{
+		sortedVotes.emplace_back(pair.second, pair.first);
+	}
+	std::sort(sortedVotes.begin(), sortedVotes.end(), [](const std::pair<size_t, std::pair<size_t, size_t>>& left, const std::pair<size_t, std::pair<size_t, size_t>>& right) { return left.first > right.first; });
+	std::vector<std::tuple<int, size_t, bool>> result;
+	for (size_t i = 0; i < sortedVotes.size() && i < maxSeeds; i++)
+	{
+		size_t node = sortedVotes[i].second.first;
+		size_t readPos = sortedVotes[i].second.second;
+		result.emplace_back(graph.nodeIDs[node] / 2, readPos, graph.nodeIDs[node] % 2 == 1);
+	}
+	return result;
+}
+
+size_t SeedIndex::NumKmers() const
+{
+	return kmers.size();
+}
+
+void SeedIndex::Save(std::string filename) const
+{
+	IndexFormat::Writer writer { filename, SeedIndexMagic, SeedIndexVersion };
+	writer.scalar(kmerSize);
+	writer.scalar(samplingRate);
+	writer.scalar(graphSize);
+	writer.array(kmers);
+	writer.array(positions);
+	writer.finish();
+}
+
+SeedIndex SeedIndex::Load(std::string filename, const AlignmentGraph& graph)
+{
+	IndexFormat::Reader reader { filename, SeedIndexMagic, SeedIndexVersion };
+	SeedIndex result;
+	reader.scalar(result.kmerSize);
+	reader.scalar(result.samplingRate);
+	reader.scalar(result.graphSize);
+	reader.array(result.kmers);
+	reader.array(result.positions);
+	result.mappedIndex = reader.mapping();
+	if (result.graphSize != graph.SizeInBp() || result.kmers.size() != result.positions.size() || result.kmerSize == 0 || result.kmerSize > 31 || result.samplingRate == 0)
+	{
+		std::cerr << "Seed index " << filename << " was not built from this graph" << std::endl;
+		std::exit(0);
+	}
+	return result;
+}
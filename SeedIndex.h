@@ -0,0 +1,42 @@
+#ifndef SeedIndex_h
+#define SeedIndex_h
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "AlignmentGraph.h"
+#include "FlatArray.h"
+
+//sampled k-mer index of the graph for finding seed hits without an external seed file
+//k-mers which span edges are included, both strands are indexed since the digraph has both
+//a k-mer is sampled if its hash is divisible by the sampling rate, so reads sample the same k-mers as the graph
+class SeedIndex
+{
+public:
+	SeedIndex();
+	SeedIndex(const AlignmentGraph& graph, size_t kmerSize, size_t samplingRate);
+	//seed hits in the form AlignOneWay takes: bigraph node id, read position at the start of the node, reverse
+	//the seeds with the most k-mer hits first, at most maxSeeds
+	std::vector<std::tuple<int, size_t, bool>> GetSeeds(const AlignmentGraph& graph, const std::string& sequence, size_t maxSeeds) const;
+	void Save(std::string filename) const;
+	static SeedIndex Load(std::string filename, const AlignmentGraph& graph);
+	size_t NumKmers() const;
+private:
+	static constexpr size_t MaxSpanningKmersPerPosition = 16;
+	static constexpr size_t MaxKmerOccurrences = 64;
+	bool sampled(uint64_t kmer) const;
+	void addKmer(uint64_t kmer, size_t position, std::vector<std::pair<uint64_t, size_t>>& result) const;
+	void addSpanningKmers(const AlignmentGraph& graph, size_t node, size_t position, std::vector<std::pair<uint64_t, size_t>>& result) const;
+	size_t kmerSize;
+	size_t samplingRate;
+	//sequence length of the graph the index was built from
+	size_t graphSize;
+	//sorted by k-mer, positions are indices to the graph sequence
+	FlatArray<uint64_t> kmers;
+	FlatArray<size_t> positions;
+	std::shared_ptr<const char> mappedIndex;
+};
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef WordSlice_h
 #define WordSlice_h
 
+#include <immintrin.h>
+#include "MultiLimbWord.h"
+
 template <typename Word>
 class WordConfiguration
 {
@@ -24,6 +27,9 @@ public:
 	//positions of the least significant bits for each chunk
 	static constexpr uint64_t LSBMask = 0x0101010101010101;
 
+	//popcount and BitPosition have hardware versions which are picked when the program starts
+	//depending on the CPU. the default versions are the portable fallback
+	__attribute__((target("default")))
 	static int popcount(uint64_t x)
 	{
 		//https://en.wikipedia.org/wiki/Hamming_weight
@@ -33,6 +39,12 @@ public:
 		return (x * 0x0101010101010101) >> 56;
 	}
 
+	__attribute__((target("popcnt")))
+	static int popcount(uint64_t x)
+	{
+		return __builtin_popcountll(x);
+	}
+
 	static uint64_t ChunkPopcounts(uint64_t value)
 	{
 		uint64_t x = value;
@@ -50,6 +62,18 @@ public:
 		return 64 + BitPosition(high, result - 64);
 	}
 
+	//pdep deposits a single bit at the position of the rank'th one in number
+	//note that pdep is microcoded and slow on AMD CPUs before Zen 3
+	__attribute__((target("popcnt,bmi,bmi2")))
+	static int BitPosition(uint64_t number, int rank)
+	{
+		int ones = __builtin_popcountll(number);
+		//rank is higher than the total number of ones
+		if (rank >= ones) return 64 + rank - ones;
+		return __builtin_ctzll(_pdep_u64(((uint64_t)1) << rank, number));
+	}
+
+	__attribute__((target("default")))
 	static int BitPosition(uint64_t number, int rank)
 	{
 		uint64_t bytes = ChunkPopcounts(number);
@@ -130,15 +154,107 @@ public:
 	}
 };
 
+//words wider than 64 bits are handled as 64-bit limbs using the uint64_t configuration
+//Word must support shifts and casting to uint64_t for taking the lowest limb
+template <typename Word, int Limbs>
+class LimbWordConfiguration
+{
+public:
+	static constexpr int WordSize = 64 * Limbs;
+
+	static uint64_t Limb(Word x, int limb)
+	{
+		return (uint64_t)(x >> (64 * limb));
+	}
+
+	static int popcount(Word x)
+	{
+		int result = 0;
+		for (int i = 0; i < Limbs; i++)
+		{
+			result += WordConfiguration<uint64_t>::popcount(Limb(x, i));
+		}
+		return result;
+	}
+
+	static int BitPosition(Word low, Word high, int rank)
+	{
+		assert(rank >= 0);
+		auto result = BitPosition(low, rank);
+		if (result < WordSize) return result;
+		return WordSize + BitPosition(high, result - WordSize);
+	}
+
+	static int BitPosition(Word number, int rank)
+	{
+		for (int i = 0; i < Limbs; i++)
+		{
+			uint64_t limb = Limb(number, i);
+			int ones = WordConfiguration<uint64_t>::popcount(limb);
+			if (rank < ones) return i * 64 + WordConfiguration<uint64_t>::BitPosition(limb, rank);
+			rank -= ones;
+		}
+		return WordSize + rank;
+	}
+
+	static Word MortonHigh(Word left, Word right)
+	{
+		return InterleaveHalves(left, right, Limbs);
+	}
+
+	static Word MortonLow(Word left, Word right)
+	{
+		return InterleaveHalves(left, right, 0);
+	}
+
+private:
+	//interleaves the 32-bit chunks starting from firstChunk into one limb each
+	static Word InterleaveHalves(Word left, Word right, int firstChunk)
+	{
+		Word result = 0;
+		for (int i = 0; i < Limbs; i++)
+		{
+			uint64_t leftChunk = (uint64_t)(left >> (32 * (firstChunk + i))) & 0xFFFFFFFF;
+			uint64_t rightChunk = (uint64_t)(right >> (32 * (firstChunk + i))) & 0xFFFFFFFF;
+			result |= ((Word)WordConfiguration<uint64_t>::Interleave(leftChunk, rightChunk)) << (64 * i);
+		}
+		return result;
+	}
+};
+
+template <>
+class WordConfiguration<__uint128_t> : public LimbWordConfiguration<__uint128_t, 2>
+{
+public:
+	static constexpr __uint128_t AllZeros = 0;
+	static constexpr __uint128_t AllOnes = ~(__uint128_t)0;
+};
+
+//AlignOneWay doesn't pick these, see AlignmentWordSize
+template <int Limbs>
+class WordConfiguration<MultiLimbWord<Limbs>> : public LimbWordConfiguration<MultiLimbWord<Limbs>, Limbs>
+{
+public:
+	static constexpr MultiLimbWord<Limbs> AllZeros = MultiLimbWord<Limbs> {};
+	static constexpr MultiLimbWord<Limbs> AllOnes = ~MultiLimbWord<Limbs> {};
+};
+
+//the operators take references so the constants need a definition
+template <int Limbs>
+constexpr MultiLimbWord<Limbs> WordConfiguration<MultiLimbWord<Limbs>>::AllZeros;
+template <int Limbs>
+constexpr MultiLimbWord<Limbs> WordConfiguration<MultiLimbWord<Limbs>>::AllOnes;
+
 class RowConfirmation
 {
 public:
-	RowConfirmation(char rows, bool partial) : rows(rows), partial(partial)
+	RowConfirmation(short rows, bool partial) : rows(rows), partial(partial)
 #ifdef EXTRACORRECTNESSASSERTIONS
 	,exists(0)
 #endif
 	{};
-	char rows;
+	//short so that the row count fits for the wide words
+	short rows;
 	bool partial;
 #ifdef EXTRACORRECTNESSASSERTIONS
 	Word exists;
@@ -173,6 +289,8 @@ template <typename LengthType, typename ScoreType, typename Word>
 class WordSlice
 {
 public:
+	typedef LengthType Length;
+	typedef ScoreType Score;
 	WordSlice() :
 	VP(0),
 	VN(0),
@@ -280,7 +398,7 @@ public:
 			return;
 		}
 		ScoreType scores[WordConfiguration<Word>::WordSize];
-		scores[0] = scoreBeforeStart + (VP & 1) - (VN & 1);
+		scores[0] = scoreBeforeStart + ((VP & 1) ? 1 : 0) - ((VN & 1) ? 1 : 0);
 		for (int i = 1; i <= confirmedRows.rows; i++)
 		{
 			auto mask = ((Word)1) << i;
@@ -337,31 +455,32 @@ public:
 	}
 
 private:
-
+	//the wide words use the 64-bit difference masks per limb
+	template <typename, typename, typename>
+	friend class WordSlice;
 
 	static uint64_t bytePrefixSums(uint64_t value, int addition)
 	{
-		value <<= WordConfiguration<Word>::ChunkBits;
+		value <<= WordConfiguration<uint64_t>::ChunkBits;
 		assert(addition >= 0);
 		value += addition;
-		return value * WordConfiguration<Word>::PrefixSumMultiplierConstant;
+		return value * WordConfiguration<uint64_t>::PrefixSumMultiplierConstant;
 	}
 
 	static uint64_t byteVPVNSum(uint64_t prefixSumVP, uint64_t prefixSumVN)
 	{
-		uint64_t result = WordConfiguration<Word>::SignMask;
+		uint64_t result = WordConfiguration<uint64_t>::SignMask;
 		assert((prefixSumVP & result) == 0);
 		assert((prefixSumVN & result) == 0);
 		result += prefixSumVP;
 		result -= prefixSumVN;
-		result ^= WordConfiguration<Word>::SignMask;
+		result ^= WordConfiguration<uint64_t>::SignMask;
 		return result;
 	}
 
 	static WordSlice mergeTwoSlices(WordSlice left, WordSlice right)
 	{
 		//O(log w), because prefix sums need log w chunks of log w bits
-		static_assert(std::is_same<Word, uint64_t>::value);
 #ifdef EXTRABITVECTORASSERTIONS
 		auto correctValue = mergeTwoSlicesCellByCell(left, right);
 #endif
@@ -373,13 +492,13 @@ private:
 		WordSlice result;
 		assert((left.VP & left.VN) == WordConfiguration<Word>::AllZeros);
 		assert((right.VP & right.VN) == WordConfiguration<Word>::AllZeros);
-		auto masks = differenceMasks(left.VP, left.VN, right.VP, right.VN, right.scoreBeforeStart - left.scoreBeforeStart);
+		auto masks = wordDifferenceMasks(left.VP, left.VN, right.VP, right.VN, right.scoreBeforeStart - left.scoreBeforeStart);
 		auto leftSmaller = masks.first;
 		auto rightSmaller = masks.second;
 		assert((leftSmaller & rightSmaller) == 0);
 		auto mask = (rightSmaller | ((leftSmaller | rightSmaller) - (rightSmaller << 1))) & ~leftSmaller;
-		uint64_t leftReduction = leftSmaller & (rightSmaller << 1);
-		uint64_t rightReduction = rightSmaller & (leftSmaller << 1);
+		Word leftReduction = leftSmaller & (rightSmaller << 1);
+		Word rightReduction = rightSmaller & (leftSmaller << 1);
 		if ((rightSmaller & 1) && left.scoreBeforeStart < right.scoreBeforeStart)
 		{
 			rightReduction |= 1;
@@ -509,17 +628,51 @@ private:
 		return { left.confirmedRows.rows, false };
 	}
 
+	//the masks of rows where left is strictly smaller and where right is strictly smaller
+	//one 64-bit limb at a time, with the score difference carried over from the previous limb
+	static std::pair<Word, Word> wordDifferenceMasks(Word leftVP, Word leftVN, Word rightVP, Word rightVN, int scoreDifference)
+	{
+		constexpr int Limbs = WordConfiguration<Word>::WordSize / 64;
+		Word leftSmaller = WordConfiguration<Word>::AllZeros;
+		Word rightSmaller = WordConfiguration<Word>::AllZeros;
+		for (int i = 0; i < Limbs; i++)
+		{
+			uint64_t limbLeftVP = (uint64_t)(leftVP >> (64 * i));
+			uint64_t limbLeftVN = (uint64_t)(leftVN >> (64 * i));
+			uint64_t limbRightVP = (uint64_t)(rightVP >> (64 * i));
+			uint64_t limbRightVN = (uint64_t)(rightVN >> (64 * i));
+			std::pair<uint64_t, uint64_t> masks;
+			if (scoreDifference >= 0)
+			{
+				masks = WordSlice<LengthType, ScoreType, uint64_t>::differenceMasks(limbLeftVP, limbLeftVN, limbRightVP, limbRightVN, scoreDifference);
+			}
+			else
+			{
+				masks = WordSlice<LengthType, ScoreType, uint64_t>::differenceMasks(limbRightVP, limbRightVN, limbLeftVP, limbLeftVN, -scoreDifference);
+				std::swap(masks.first, masks.second);
+			}
+			leftSmaller |= ((Word)masks.first) << (64 * i);
+			rightSmaller |= ((Word)masks.second) << (64 * i);
+			if (i + 1 < Limbs)
+			{
+				scoreDifference += WordConfiguration<uint64_t>::popcount(limbRightVP) - WordConfiguration<uint64_t>::popcount(limbRightVN);
+				scoreDifference -= WordConfiguration<uint64_t>::popcount(limbLeftVP) - WordConfiguration<uint64_t>::popcount(limbLeftVN);
+			}
+		}
+		return std::make_pair(leftSmaller, rightSmaller);
+	}
+
 	static std::pair<uint64_t, uint64_t> differenceMasks(uint64_t leftVP, uint64_t leftVN, uint64_t rightVP, uint64_t rightVN, int scoreDifference)
 	{
 #ifdef EXTRABITVECTORASSERTIONS
 		auto correctValue = differenceMasksCellByCell(leftVP, leftVN, rightVP, rightVN, scoreDifference);
 #endif
 		assert(scoreDifference >= 0);
-		const uint64_t signmask = WordConfiguration<Word>::SignMask;
-		const uint64_t lsbmask = WordConfiguration<Word>::LSBMask;
-		const int chunksize = WordConfiguration<Word>::ChunkBits;
-		const uint64_t allones = WordConfiguration<Word>::AllOnes;
-		const uint64_t allzeros = WordConfiguration<Word>::AllZeros;
+		const uint64_t signmask = WordConfiguration<uint64_t>::SignMask;
+		const uint64_t lsbmask = WordConfiguration<uint64_t>::LSBMask;
+		const int chunksize = WordConfiguration<uint64_t>::ChunkBits;
+		const uint64_t allones = WordConfiguration<uint64_t>::AllOnes;
+		const uint64_t allzeros = WordConfiguration<uint64_t>::AllZeros;
 		uint64_t VPcommon = ~(leftVP & rightVP);
 		uint64_t VNcommon = ~(leftVN & rightVN);
 		leftVP &= VPcommon;
@@ -527,13 +680,13 @@ private:
 		rightVP &= VPcommon;
 		rightVN &= VNcommon;
 		//left is lower everywhere
-		if (scoreDifference > WordConfiguration<Word>::popcount(rightVN) + WordConfiguration<Word>::popcount(leftVP))
+		if (scoreDifference > WordConfiguration<uint64_t>::popcount(rightVN) + WordConfiguration<uint64_t>::popcount(leftVP))
 		{
 			return std::make_pair(allones, allzeros);
 		}
 		if (scoreDifference == 128 && rightVN == allones && leftVP == allones)
 		{
-			return std::make_pair(allones ^ ((Word)1 << (WordConfiguration<Word>::WordSize-1)), allzeros);
+			return std::make_pair(allones ^ ((uint64_t)1 << (WordConfiguration<uint64_t>::WordSize-1)), allzeros);
 		}
 		else if (scoreDifference == 0 && rightVN == allones && leftVP == allones)
 		{
@@ -541,14 +694,14 @@ private:
 		}
 		assert(scoreDifference >= 0);
 		assert(scoreDifference < 128);
-		uint64_t byteVPVNSumLeft = byteVPVNSum(bytePrefixSums(WordConfiguration<Word>::ChunkPopcounts(leftVP), 0), bytePrefixSums(WordConfiguration<Word>::ChunkPopcounts(leftVN), 0));
-		uint64_t byteVPVNSumRight = byteVPVNSum(bytePrefixSums(WordConfiguration<Word>::ChunkPopcounts(rightVP), scoreDifference), bytePrefixSums(WordConfiguration<Word>::ChunkPopcounts(rightVN), 0));
+		uint64_t byteVPVNSumLeft = byteVPVNSum(bytePrefixSums(WordConfiguration<uint64_t>::ChunkPopcounts(leftVP), 0), bytePrefixSums(WordConfiguration<uint64_t>::ChunkPopcounts(leftVN), 0));
+		uint64_t byteVPVNSumRight = byteVPVNSum(bytePrefixSums(WordConfiguration<uint64_t>::ChunkPopcounts(rightVP), scoreDifference), bytePrefixSums(WordConfiguration<uint64_t>::ChunkPopcounts(rightVN), 0));
 		uint64_t difference = byteVPVNSumLeft;
 		{
 			//take the bytvpvnsumright and split it from positive/negative values into two vectors with positive values, one which needs to be added and the other deducted
 			//smearmask is 1 where the number needs to be deducted, and 0 where it needs to be added
 			//except sign bits which are all 0
-			uint64_t smearmask = ((byteVPVNSumRight & signmask) >> (chunksize-1)) * ((((Word)1) << (chunksize-1))-1);
+			uint64_t smearmask = ((byteVPVNSumRight & signmask) >> (chunksize-1)) * ((((uint64_t)1) << (chunksize-1))-1);
 			assert((smearmask & signmask) == 0);
 			uint64_t deductions = ~smearmask & byteVPVNSumRight & ~signmask;
 			//byteVPVNSumRight is in one's complement so take the not-value + 1
@@ -601,11 +754,11 @@ private:
 			//difference now contains the prefix sums difference (left-right) at each byte at (bit)'th bit
 			//left < right when the prefix sum difference is negative (sign bit is set)
 			uint64_t negative = (difference & signmask);
-			resultLeftSmallerThanRight |= negative >> (WordConfiguration<Word>::ChunkBits - 1 - bit);
+			resultLeftSmallerThanRight |= negative >> (WordConfiguration<uint64_t>::ChunkBits - 1 - bit);
 			//Test equality to zero. If it's zero, substracting one will make the sign bit 0, otherwise 1
 			uint64_t notEqualToZero = ((difference | signmask) - lsbmask) & signmask;
 			//right > left when the prefix sum difference is positive (not zero and not negative)
-			resultRightSmallerThanLeft |= (notEqualToZero & ~negative) >> (WordConfiguration<Word>::ChunkBits - 1 - bit);
+			resultRightSmallerThanLeft |= (notEqualToZero & ~negative) >> (WordConfiguration<uint64_t>::ChunkBits - 1 - bit);
 		}
 #ifdef EXTRABITVECTORASSERTIONS
 		assert(resultLeftSmallerThanRight == correctValue.first);
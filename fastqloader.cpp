@@ -1,41 +1,262 @@
 #include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+#include <zlib.h>
 #include "fastqloader.h"
 #include "CommonUtils.h"
 
-std::vector<FastQ> loadFastqFastqFromFile(std::string filename)
+//gives the bytes which were read to recognize the compression again before the rest of the input,
+//so stdin and pipes work without seeking back
+class RewoundStreamBuf : public std::streambuf
+{
+public:
+	RewoundStreamBuf(std::istream& source, const char* header, size_t headerSize) :
+	source(source),
+	buffer(std::max(BufferSize, headerSize))
+	{
+		std::copy(header, header + headerSize, buffer.data());
+		setg(buffer.data(), buffer.data(), buffer.data() + headerSize);
+	}
+protected:
+	int_type underflow() override
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		source.read(buffer.data(), buffer.size());
+		size_t got = source.gcount();
+		if (got == 0) return traits_type::eof();
+		setg(buffer.data(), buffer.data(), buffer.data() + got);
+		return traits_type::to_int_type(*gptr());
+	}
+private:
+	static constexpr size_t BufferSize = 1 << 16;
+	std::istream& source;
+	std::vector<char> buffer;
+};
+
+//decompresses gzip input one member after another, so concatenated gzip files (including bgzip) work
+class GzipStreamBuf : public std::streambuf
+{
+public:
+	GzipStreamBuf(std::istream& source) :
+	source(source),
+	inBuffer(BufferSize),
+	outBuffer(BufferSize),
+	finished(false)
+	{
+		memset(&stream, 0, sizeof(stream));
+		//15+16: gzip header
+		inflateInit2(&stream, 15 + 16);
+		setg(outBuffer.data(), outBuffer.data(), outBuffer.data());
+	}
+	~GzipStreamBuf()
+	{
+		inflateEnd(&stream);
+	}
+protected:
+	int_type underflow() override
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		while (!finished)
+		{
+			if (stream.avail_in == 0)
+			{
+				source.read(inBuffer.data(), inBuffer.size());
+				stream.next_in = (Bytef*)inBuffer.data();
+				stream.avail_in = source.gcount();
+				if (stream.avail_in == 0)
+				{
+					finished = true;
+					break;
+				}
+			}
+			stream.next_out = (Bytef*)outBuffer.data();
+			stream.avail_out = outBuffer.size();
+			int status = inflate(&stream, Z_NO_FLUSH);
+			if (status == Z_STREAM_END)
+			{
+				inflateReset(&stream);
+			}
+			else if (status != Z_OK && status != Z_BUF_ERROR)
+			{
+				std::cerr << "Error decompressing gzip input" << std::endl;
+				finished = true;
+			}
+			size_t produced = outBuffer.size() - stream.avail_out;
+			if (produced > 0)
+			{
+				setg(outBuffer.data(), outBuffer.data(), outBuffer.data() + produced);
+				return traits_type::to_int_type(*gptr());
+			}
+		}
+		return traits_type::eof();
+	}
+private:
+	static constexpr size_t BufferSize = 1 << 16;
+	std::istream& source;
+	std::vector<char> inBuffer;
+	std::vector<char> outBuffer;
+	z_stream stream;
+	bool finished;
+};
+
+//bgzip files are a series of independent gzip blocks of at most 64kb with the compressed size in the header
+//so a batch of blocks can be read and decompressed by several threads at once
+//the next batch is decompressed in the background while the current one is being parsed
+class BgzfStreamBuf : public std::streambuf
+{
+public:
+	BgzfStreamBuf(std::istream& source, size_t numThreads) :
+	source(source),
+	numThreads(std::max((size_t)1, numThreads)),
+	current()
+	{
+		setg(nullptr, nullptr, nullptr);
+		next = std::async(std::launch::async, [this]() { return decompressBatch(); });
+	}
+	~BgzfStreamBuf()
+	{
+		if (next.valid()) next.wait();
+	}
+protected:
+	int_type underflow() override
+	{
+		if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+		while (next.valid())
+		{
+			current = next.get();
+			if (current.size() == 0) break;
+			next = std::async(std::launch::async, [this]() { return decompressBatch(); });
+			setg(&current[0], &current[0], &current[0] + current.size());
+			return traits_type::to_int_type(*gptr());
+		}
+		return traits_type::eof();
+	}
+private:
+	static constexpr size_t BlocksPerThread = 16;
+	static constexpr size_t HeaderSize = 18;
+	static constexpr size_t FooterSize = 8;
+	static bool decompressBlock(const std::string& block, std::string& result)
+	{
+		if (block.size() < HeaderSize + FooterSize) return false;
+		size_t uncompressedSize = (uint32_t)(unsigned char)block[block.size()-4] | ((uint32_t)(unsigned char)block[block.size()-3] << 8) | ((uint32_t)(unsigned char)block[block.size()-2] << 16) | ((uint32_t)(unsigned char)block[block.size()-1] << 24);
+		result.resize(uncompressedSize);
+		if (uncompressedSize == 0) return true;
+		z_stream stream;
+		memset(&stream, 0, sizeof(stream));
+		//-15: raw deflate, the header has already been parsed
+		if (inflateInit2(&stream, -15) != Z_OK) return false;
+		stream.next_in = (Bytef*)block.data() + HeaderSize;
+		stream.avail_in = block.size() - HeaderSize - FooterSize;
+		stream.next_out = (Bytef*)&result[0];
+		stream.avail_out = uncompressedSize;
+		int status = inflate(&stream, Z_FINISH);
+		inflateEnd(&stream);
+		return status == Z_STREAM_END && stream.avail_out == 0;
+	}
+	std::string decompressBatch()
+	{
+		std::vector<std::string> blocks;
+		while (blocks.size() < numThreads * BlocksPerThread)
+		{
+			std::string block(HeaderSize, 0);
+			source.read(&block[0], HeaderSize);
+			if (source.gcount() == 0) break;
+			if ((size_t)source.gcount() < HeaderSize || !isBgzfHeader(block.data()))
+			{
+				std::cerr << "Error decompressing bgzip input" << std::endl;
+				break;
+			}
+			size_t blockSize = ((size_t)(unsigned char)block[16] | ((size_t)(unsigned char)block[17] << 8)) + 1;
+			block.resize(blockSize);
+			source.read(&block[HeaderSize], blockSize - HeaderSize);
+			if ((size_t)source.gcount() < blockSize - HeaderSize)
+			{
+				std::cerr << "Error decompressing bgzip input" << std::endl;
+				break;
+			}
+			blocks.emplace_back(std::move(block));
+		}
+		std::vector<std::string> decompressed(blocks.size());
+		//not vector<bool>, the threads write next to each other
+		std::vector<char> ok(blocks.size(), true);
+		std::vector<std::thread> threads;
+		size_t usedThreads = std::min(numThreads, blocks.size());
+		for (size_t thread = 0; thread < usedThreads; thread++)
+		{
+			threads.emplace_back([&blocks, &decompressed, &ok, thread, usedThreads]() {
+				for (size_t i = thread; i < blocks.size(); i += usedThreads)
+				{
+					ok[i] = decompressBlock(blocks[i], decompressed[i]);
+				}
+			});
+		}
+		std::string result;
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			threads[i].join();
+		}
+		for (size_t i = 0; i < blocks.size(); i++)
+		{
+			if (!ok[i])
+			{
+				std::cerr << "Error decompressing bgzip input" << std::endl;
+				break;
+			}
+			result += decompressed[i];
+		}
+		return result;
+	}
+public:
+	static bool isBgzfHeader(const char* header)
+	{
+		//gzip magic, deflate, FEXTRA, XLEN 6, subfield "BC" of length 2
+		return (unsigned char)header[0] == 0x1f && (unsigned char)header[1] == 0x8b && header[2] == 8 && (header[3] & 4) && header[10] == 6 && header[11] == 0 && header[12] == 'B' && header[13] == 'C' && header[14] == 2 && header[15] == 0;
+	}
+private:
+	std::istream& source;
+	size_t numThreads;
+	std::string current;
+	std::future<std::string> next;
+};
+
+bool endsWith(const std::string& str, const std::string& suffix)
+{
+	if (str.size() < suffix.size()) return false;
+	return str.substr(str.size() - suffix.size()) == suffix;
+}
+
+void streamFastqFastqFromStream(std::istream& file, std::function<void(FastQ&)> f)
 {
-	std::ifstream file {filename};
-	std::vector<FastQ> result;
 	do
 	{
 		std::string line;
 		std::getline(file, line);
-		if (line[0] != '@') continue;
+		if (line.size() == 0 || line[0] != '@') continue;
 		FastQ newread;
 		if (line.back() == '\r') line.pop_back();
 		newread.seq_id = line.substr(1);
 		std::getline(file, line);
-		if (line.back() == '\r') line.pop_back();
+		if (line.size() > 0 && line.back() == '\r') line.pop_back();
 		newread.sequence = line;
 		std::getline(file, line);
 		std::getline(file, line);
-		if (line.back() == '\r') line.pop_back();
+		if (line.size() > 0 && line.back() == '\r') line.pop_back();
 		newread.quality = line;
-		result.push_back(newread);
+		f(newread);
 	} while (file.good());
-	return result;
 }
 
-std::vector<FastQ> loadFastqFastaFromFile(std::string filename)
+void streamFastqFastaFromStream(std::istream& file, std::function<void(FastQ&)> f)
 {
-	std::ifstream file {filename};
-	std::vector<FastQ> result;
 	std::string line;
 	std::getline(file, line);
 	do
 	{
-		if (line[0] != '>')
+		if (line.size() == 0 || line[0] != '>')
 		{
 			std::getline(file, line);
 			continue;
@@ -47,26 +268,89 @@ std::vector<FastQ> loadFastqFastaFromFile(std::string filename)
 		do
 		{
 			std::getline(file, line);
-			if (line[0] == '>') break;
-			if (line.back() == '\r') line.pop_back();
+			if (line.size() > 0 && line[0] == '>') break;
+			if (line.size() > 0 && line.back() == '\r') line.pop_back();
 			newread.sequence += line;
 		} while (file.good());
-		for (size_t i = 0; i < newread.sequence.size(); i++)
-		{
-			newread.quality += '!';
-		}
-		result.push_back(newread);
+		newread.quality = std::string(newread.sequence.size(), '!');
+		f(newread);
 	} while (file.good());
-	return result;
+}
+
+//guess the format from the first character, for stdin, pipes and unknown suffixes
+void streamFastqFromUnknownStream(std::istream& file, std::function<void(FastQ&)> f)
+{
+	while (file.good() && (file.peek() == '\n' || file.peek() == '\r')) file.get();
+	if (!file.good()) return;
+	if (file.peek() == '>')
+	{
+		streamFastqFastaFromStream(file, f);
+	}
+	else if (file.peek() == '@')
+	{
+		streamFastqFastqFromStream(file, f);
+	}
+	else
+	{
+		std::cerr << "Unknown read file format" << std::endl;
+	}
+}
+
+void streamFastqFromPlainStream(std::istream& file, std::string filename, std::function<void(FastQ&)> f)
+{
+	if (endsWith(filename, ".gz")) filename = filename.substr(0, filename.size() - 3);
+	if (endsWith(filename, ".bgz")) filename = filename.substr(0, filename.size() - 4);
+	if (endsWith(filename, ".fastq") || endsWith(filename, ".fq"))
+	{
+		streamFastqFastqFromStream(file, f);
+	}
+	else if (endsWith(filename, ".fasta") || endsWith(filename, ".fa"))
+	{
+		streamFastqFastaFromStream(file, f);
+	}
+	else
+	{
+		streamFastqFromUnknownStream(file, f);
+	}
+}
+
+void streamFastqFromFile(std::string filename, std::function<void(FastQ&)> f, size_t numThreads)
+{
+	std::ifstream file;
+	if (filename != "-") file.open(filename, std::ios::in | std::ios::binary);
+	std::istream& source = filename == "-" ? std::cin : file;
+	//compression is recognized from the magic bytes, not the suffix
+	char header[18] {};
+	source.read(header, sizeof(header));
+	size_t headerSize = source.gcount();
+	bool gzipped = headerSize >= 2 && (unsigned char)header[0] == 0x1f && (unsigned char)header[1] == 0x8b;
+	bool bgzipped = headerSize == sizeof(header) && BgzfStreamBuf::isBgzfHeader(header);
+	source.clear();
+	RewoundStreamBuf rewound {source, header, headerSize};
+	std::istream input {&rewound};
+	if (bgzipped && numThreads > 1)
+	{
+		BgzfStreamBuf buf {input, numThreads};
+		std::istream decompressed {&buf};
+		streamFastqFromPlainStream(decompressed, filename, f);
+	}
+	else if (gzipped)
+	{
+		GzipStreamBuf buf {input};
+		std::istream decompressed {&buf};
+		streamFastqFromPlainStream(decompressed, filename, f);
+	}
+	else
+	{
+		streamFastqFromPlainStream(input, filename, f);
+	}
 }
 
 std::vector<FastQ> loadFastqFromFile(std::string filename)
 {
-	if (filename.substr(filename.size()-6) == ".fastq") return loadFastqFastqFromFile(filename);
-	if (filename.substr(filename.size()-3) == ".fq") return loadFastqFastqFromFile(filename);
-	if (filename.substr(filename.size()-6) == ".fasta") return loadFastqFastaFromFile(filename);
-	if (filename.substr(filename.size()-3) == ".fa") return loadFastqFastaFromFile(filename);
-	return std::vector<FastQ>{};
+	std::vector<FastQ> result;
+	streamFastqFromFile(filename, [&result](FastQ& read) { result.emplace_back(std::move(read)); }, 1);
+	return result;
 }
 
 FastQ FastQ::reverseComplement() const
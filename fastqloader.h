@@ -1,6 +1,7 @@
 #ifndef FastqLoader_H
 #define FastqLoader_H
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -13,5 +14,9 @@ public:
 };
 
 std::vector<FastQ> loadFastqFromFile(std::string filename);
+//calls f for each read in the file without keeping the reads in memory
+//filename "-" reads from stdin, and named pipes work like regular files
+//gzip and bgzip compressed files are decompressed, bgzip with numThreads threads
+void streamFastqFromFile(std::string filename, std::function<void(FastQ&)> f, size_t numThreads);
 
 #endif